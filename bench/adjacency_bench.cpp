@@ -0,0 +1,115 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  adjacency_bench.cpp
+ *
+ *    Description:  Memory and traversal time of pointer adjacency versus CSR arrays
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:12:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+
+using namespace std;
+
+/* Points scattered over the unit sphere, so leaves lie on a surface as in a scan */
+void sphere_points(int n, vector<double> &points)
+{
+    points.resize(NDIM * n);
+    for (int i = 0; i < n; i++)
+    {
+        double p[NDIM], r2;
+        do
+        {
+            for (int j = 0; j < NDIM; j++)
+                p[j] = 2 * (rand() / (double) RAND_MAX) - 1;
+            r2 = norm2(p);
+        } while (r2 < EPS || r2 > 1);
+
+        for (int j = 0; j < NDIM; j++)
+            points[NDIM * i + j] = p[j] / sqrt(r2);
+    }
+}
+
+/* Bytes held by the edge objects, the edge vector and every neighbor list */
+size_t pointer_bytes(OctreeGraph &graph)
+{
+    size_t bytes = graph.bytesUsed() + graph.getEdges().capacity() * sizeof(OctreeEdge *);
+    for (int i = 0; i < graph.getNumVertices(); i++)
+        bytes += graph.getVertex(i)->getNeighbors().capacity() * sizeof(OctreePoint *);
+    return bytes;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 1000000, depth = 10, passes = 10;
+    if (argc > 1)
+        n = atoi(argv[1]);
+    if (argc > 2)
+        depth = atoi(argv[2]);
+
+    init_globals();
+
+    srand(1);
+    vector<double> points;
+    sphere_points(n, points);
+
+    double limits[2 * NDIM] = {0, 0, 0, 0, 0, 0};
+    Octree tree(limits, depth);
+    OctreeGraph graph;
+    QuietCout quiet;      // silence the progress report of addPoints
+    tree.addPoints(&points[0], NULL, n, graph);
+    quiet.restore();
+
+    int num_vertices = graph.getNumVertices();
+    cout << n << " points on a sphere, depth " << depth << ", FOOT " << FOOT << ": "
+         << num_vertices << " vertices, " << graph.getNumEdges() << " directed edges\n";
+
+    /* Pointer layout: sum the neighbor indices through the lists */
+    size_t before = pointer_bytes(graph);
+    long check_pointer = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+        for (int i = 0; i < num_vertices; i++)
+        {
+            vector<OctreePoint *> &neighbors = graph.getVertex(i)->getNeighbors();
+            for (unsigned int j = 0; j < neighbors.size(); j++)
+                check_pointer += neighbors[j]->getIndex();
+        }
+    double t_pointer = seconds_since(start) / passes;
+
+    start = chrono::steady_clock::now();
+    graph.buildAdjacency();
+    double t_build = seconds_since(start);
+    graph.releasePointerEdges();
+    size_t after = graph.bytesUsed();
+
+    /* CSR layout: the same sum through the spans */
+    long check_csr = 0;
+    start = chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++)
+        for (int i = 0; i < num_vertices; i++)
+        {
+            Span<const int> adjacent = graph.getAdjacent(i);
+            for (int j = 0; j < adjacent.size(); j++)
+                check_csr += adjacent[j];
+        }
+    double t_csr = seconds_since(start) / passes;
+
+    cout << setw(10) << "layout" << setw(14) << "KB" << setw(14) << "sweep ms" << endl;
+    cout << setw(10) << "pointer" << setw(14) << before / 1024
+         << setw(14) << 1000 * t_pointer << endl;
+    cout << setw(10) << "csr" << setw(14) << after / 1024
+         << setw(14) << 1000 * t_csr << endl;
+    cout << "CSR build " << 1000 * t_build << " ms"
+         << (check_pointer == check_csr ? "" : "  (MISMATCH)") << endl;
+
+    return check_status(check_pointer != check_csr);
+}
@@ -0,0 +1,90 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  alloc_bench.cpp
+ *
+ *    Description:  Build and teardown time of heap-allocated versus arena-built trees
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 12:48:05 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+
+using namespace std;
+
+/* Points scattered over the unit sphere, so leaves lie on a surface as in a scan */
+void sphere_points(int n, vector<double> &points)
+{
+    points.resize(NDIM * n);
+    for (int i = 0; i < n; i++)
+    {
+        double p[NDIM], r2;
+        do
+        {
+            for (int j = 0; j < NDIM; j++)
+                p[j] = 2 * (rand() / (double) RAND_MAX) - 1;
+            r2 = norm2(p);
+        } while (r2 < EPS || r2 > 1);
+
+        for (int j = 0; j < NDIM; j++)
+            points[NDIM * i + j] = p[j] / sqrt(r2);
+    }
+}
+
+void bench_mode(bool use_arena, const vector<double> &points, int depth)
+{
+    double limits[2 * NDIM] = {0, 0, 0, 0, 0, 0};
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Octree *tree = new Octree(limits, depth, use_arena);
+    OctreeGraph *graph = new OctreeGraph(use_arena);
+    QuietCout quiet;      // silence the progress report of addPoints
+    tree->addPoints(&points[0], NULL, points.size() / NDIM, *graph);
+    quiet.restore();
+    double t_build = seconds_since(start);
+
+    size_t reserved = tree->bytesReserved() + graph->bytesReserved(),
+           used = tree->bytesUsed() + graph->bytesUsed();
+    int num_vertices = graph->getNumVertices(), num_edges = graph->getNumEdges();
+
+    start = chrono::steady_clock::now();
+    delete graph;
+    delete tree;
+    double t_teardown = seconds_since(start);
+
+    cout << setw(8) << (use_arena ? "arena" : "heap")
+         << setw(10) << num_vertices << setw(12) << num_edges
+         << setw(12) << (int) (1000 * t_build) << setw(12) << (int) (1000 * t_teardown)
+         << setw(14) << reserved / 1024 << setw(14) << used / 1024 << endl;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 1000000, depth = 10;
+    if (argc > 1)
+        n = atoi(argv[1]);
+    if (argc > 2)
+        depth = atoi(argv[2]);
+
+    init_globals();
+
+    srand(1);
+    vector<double> points;
+    sphere_points(n, points);
+
+    cout << n << " points on a sphere, depth " << depth << ", FOOT " << FOOT << ":\n";
+    cout << setw(8) << "mode" << setw(10) << "vertices" << setw(12) << "edges"
+         << setw(12) << "build ms" << setw(12) << "free ms"
+         << setw(14) << "reserved KB" << setw(14) << "used KB" << endl;
+    bench_mode(false, points, depth);
+    bench_mode(true, points, depth);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  bench_util.h
+ *
+ *    Description:  Timing, output silencing, example loading and exit status shared by
+ *                  the benchmarks
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 02:05:11 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "octree.h"
+#include "globals.h"
+#include "pcd_io.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#define EXAMPLE_DIR "../example/"   // Benches run from bench/, next to the example
+
+/* #####   Timing   ################################################################# */
+
+inline double seconds_since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+inline double ms_since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/*
+ * =====================================================================================
+ *        Class:  QuietCout
+ *  Description:  Sends cout nowhere from construction (or quiet()) until restore() or
+ *                  destruction, to keep the progress reports of the library out of
+ *                  the tables
+ * =====================================================================================
+ */
+class QuietCout
+{
+    streambuf *old_buf;
+    nullbuf null_obj;
+
+public:
+    QuietCout() : old_buf(NULL)
+    {
+        quiet();
+    }
+
+    ~QuietCout()
+    {
+        restore();
+    }
+
+    void quiet()
+    {
+        if (old_buf == NULL)
+            old_buf = cout.rdbuf(&null_obj);
+    }
+
+    void restore()
+    {
+        if (old_buf != NULL)
+            cout.rdbuf(old_buf);
+        old_buf = NULL;
+    }
+};
+
+/* #####   Example data   ########################################################### */
+
+/* Parse the example configuration; returns the path of its first point file */
+inline string example_cloud()
+{
+    parse_globals(EXAMPLE_DIR "default.cfg");
+    return EXAMPLE_DIR + PLY_NAMES[0];
+}
+
+/* Read every point of a file, quietly; returns the number read, or -1 */
+inline long read_cloud(const string &filename, vector<double> &points, vector<float> &normals)
+{
+    QuietCout quiet;
+    PointReader reader;
+    if (!reader.open(filename.c_str()))
+        return -1;
+    points.resize(NDIM * reader.num_points);
+    normals.resize(NDIM * reader.num_points);
+    return reader.read(reader.num_points, &points[0], &normals[0]);
+}
+
+/* #####   Exit status   ############################################################ */
+
+/*
+ * Exit status of a bench whose agreement checks found the given number of failures:
+ * zero when there were none, so a script can gate on the checks.
+ */
+inline int check_status(long failures)
+{
+    if (failures != 0)
+        cerr << "FAILED: " << failures << " agreement check(s) did not hold" << endl;
+    return failures != 0;
+}
+
+#endif // BENCH_UTIL_H
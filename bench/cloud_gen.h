@@ -0,0 +1,159 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  cloud_gen.h
+ *
+ *    Description:  Deterministic synthetic point clouds in the unit cube, and a binary
+ *                  PLY writer for them
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:14:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef CLOUD_GEN_H
+#define CLOUD_GEN_H
+
+#include "octree.h"
+#include "visualize.h"
+#include <random>
+#include <string>
+#include <sstream>
+
+#define CLOUD_SEED 20261017         // Every generator starts from this seed
+#define CLOUD_CLUSTERS 32           // Centres of the clustered pattern
+#define CLOUD_CLUSTER_SIGMA 0.02    // Spread of each cluster
+#define CLOUD_NOISE 0.002           // Thickness of the surface and scan-line patterns
+
+/*
+ * UNIFORM     uniform in the volume
+ * SURFACE     a smooth height field z = f(x, y), slightly noisy; leaves form a 2-D sheet
+ * CLUSTERED   gaussian blobs around random centres; very uneven leaf occupancy
+ * SCANLINE    the same height field sampled along sparse rows, densely along each
+ *               row, as a line scanner would
+ */
+enum cloud_enum {CLOUD_UNIFORM, CLOUD_SURFACE, CLOUD_CLUSTERED, CLOUD_SCANLINE, NUM_CLOUDS};
+
+const char *const CLOUD_NAMES[NUM_CLOUDS] = {"uniform", "surface", "clustered", "scanline"};
+
+// Limits of every generated cloud
+const double CLOUD_LIMITS[2 * NDIM] = {0, 1, 0, 1, 0, 1};
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/* Pattern of the given name, or NUM_CLOUDS */
+inline cloud_enum cloud_by_name(const string &name)
+{
+    for (int c = 0; c < NUM_CLOUDS; c++)
+        if (name == CLOUD_NAMES[c])
+            return (cloud_enum) c;
+    return NUM_CLOUDS;
+}
+
+inline double surface_height(double x, double y)
+{
+    return .5 + .15 * sin(2 * M_PI * x) * cos(3 * M_PI * y) + .05 * sin(9 * x + 4 * y);
+}
+
+inline double clamp_unit(double x)
+{
+    return min(max(x, 0.0), 1.0);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void generate_cloud(cloud_enum, long, double*)
+ *  Description:  Fill points (NDIM per point) with num_points points of the given
+ *                  pattern.  The same pattern and count always give the same cloud.
+ * =====================================================================================
+ */
+inline void generate_cloud(cloud_enum pattern, long num_points, double *points)
+{
+    mt19937_64 rng(CLOUD_SEED + pattern);
+    uniform_real_distribution<double> unit(0, 1);
+    normal_distribution<double> noise(0, CLOUD_NOISE);
+
+    switch (pattern)
+    {
+        case CLOUD_UNIFORM:
+            for (long i = 0; i < NDIM * num_points; i++)
+                points[i] = unit(rng);
+            break;
+
+        case CLOUD_SURFACE:
+            for (long i = 0; i < num_points; i++)
+            {
+                double *p = &points[NDIM * i];
+                p[0] = unit(rng);
+                p[1] = unit(rng);
+                p[2] = clamp_unit(surface_height(p[0], p[1]) + noise(rng));
+            }
+            break;
+
+        case CLOUD_CLUSTERED:
+        {
+            double centres[CLOUD_CLUSTERS][NDIM];
+            for (int c = 0; c < CLOUD_CLUSTERS; c++)
+                for (int j = 0; j < NDIM; j++)
+                    centres[c][j] = .1 + .8 * unit(rng);
+
+            normal_distribution<double> spread(0, CLOUD_CLUSTER_SIGMA);
+            uniform_int_distribution<int> which(0, CLOUD_CLUSTERS - 1);
+            for (long i = 0; i < num_points; i++)
+            {
+                int c = which(rng);
+                for (int j = 0; j < NDIM; j++)
+                    points[NDIM * i + j] = clamp_unit(centres[c][j] + spread(rng));
+            }
+            break;
+        }
+
+        case CLOUD_SCANLINE:
+        {
+            // Rows a few times sparser than the spacing along them
+            long num_rows = max(1l, (long) sqrt((double) num_points) / 8),
+                 per_row = (num_points + num_rows - 1) / num_rows;
+            for (long i = 0; i < num_points; i++)
+            {
+                double *p = &points[NDIM * i];
+                long row = i / per_row, k = i % per_row;
+                p[0] = (k + .5) / per_row;
+                p[1] = (row + .5) / num_rows;
+                p[2] = clamp_unit(surface_height(p[0], p[1]) + noise(rng));
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool write_cloud_ply(const char*, const double*, long)
+ *  Description:  Write the points as a binary little-endian PLY of doubles
+ * =====================================================================================
+ */
+inline bool write_cloud_ply(const char *filename, const double *points, long num_points)
+{
+    PlyWriter out;
+    if (!out.open(filename))
+        return false;
+
+    ostringstream header;
+    header << "ply\nformat binary_little_endian 1.0\n"
+           << "element vertex " << num_points << "\n"
+           << "property double x\nproperty double y\nproperty double z\nend_header\n";
+    out.write(header.str());
+    for (long i = 0; i < NDIM * num_points; i++)
+        out.put(points[i]);
+    return out.close();
+}
+
+#endif // CLOUD_GEN_H
@@ -0,0 +1,116 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  dijkstra_bench.cpp
+ *
+ *    Description:  Relaxations and time of dist_from against the old pointer-ordered
+ *                  priority queue, on the bunny graph of the example
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:02:51 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "graph_traverse.h"
+#include <queue>
+
+using namespace std;
+
+/* The search dist_from used to run: a queue ordered by pointer value, not distance */
+vector<double> legacy_dist_from(OctreePoint *start, OctreeGraph &graph, long &relaxations)
+{
+    vector<double> distances(graph.getNumVertices(), numeric_limits<double>::infinity());
+    priority_queue<OctreePoint *> pq;
+    pq.emplace(start);
+    distances[start->getIndex()] = 0;
+
+    while (!pq.empty())
+    {
+        OctreePoint *base = pq.top();
+        pq.pop();
+        int base_index = base->getIndex();
+
+        for (unsigned int i = 0; i < base->getNeighbors().size(); i++)
+        {
+            OctreePoint *neighbor = base->getNeighbor(i);
+            int neighbor_index = neighbor->getIndex();
+            double new_distance = distances[base_index] + point_distance(base, neighbor);
+
+            if (new_distance < distances[neighbor_index])
+            {
+                pq.emplace(neighbor);
+                distances[neighbor_index] = new_distance;
+                relaxations++;
+            }
+        }
+    }
+    return distances;
+}
+
+void report(const char *name, int num_sources, long relaxations, double seconds)
+{
+    cout << setw(14) << name << setw(16) << relaxations / num_sources
+         << setw(14) << 1000 * seconds / num_sources << endl;
+}
+
+int main(int argc, char **argv)
+{
+    int num_sources = 3;   // the legacy search takes seconds per query
+    if (argc > 1)
+        num_sources = atoi(argv[1]);
+
+    string filename = example_cloud();
+
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    if (!load_points_from_pxx(filename.c_str(), tree, graph))
+        return -1;
+
+    srand(1);
+    vector<OctreePoint *> sources;
+    for (int s = 0; s < num_sources; s++)
+        sources.push_back(graph.getVertex(rand() % graph.getNumVertices()));
+
+    cout << "\n" << num_sources << " sources, " << graph.getNumVertices() << " vertices:\n";
+    cout << setw(14) << "search" << setw(16) << "relaxations" << setw(14) << "ms/query" << endl;
+
+    long relaxations = 0;
+    double max_error = 0;
+    vector<vector<double> > reference;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int s = 0; s < num_sources; s++)
+        reference.push_back(legacy_dist_from(sources[s], graph, relaxations));
+    report("legacy", num_sources, relaxations, seconds_since(start));
+
+    PathWorkspace work;
+    relaxations = 0;
+    start = chrono::steady_clock::now();
+    for (int s = 0; s < num_sources; s++)
+    {
+        dist_from(sources[s], graph, work);
+        relaxations += work.relaxations;
+        for (int i = 0; i < graph.getNumVertices(); i++)
+            if (work.distances[i] != reference[s][i])
+                max_error = max(max_error, fabs(work.distances[i] - reference[s][i]));
+    }
+    report("heap", num_sources, relaxations, seconds_since(start));
+
+    graph.buildAdjacency(point_distance);
+    relaxations = 0;
+    start = chrono::steady_clock::now();
+    for (int s = 0; s < num_sources; s++)
+    {
+        dist_from(sources[s], graph, work, NULL);
+        relaxations += work.relaxations;
+    }
+    report("heap+csr", num_sources, relaxations, seconds_since(start));
+
+    cout << "largest difference from legacy: " << max_error << endl;
+    return check_status(max_error != 0);
+}
@@ -0,0 +1,197 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  knn_bench.cpp
+ *
+ *    Description:  Octree::knn and knnBatch on the bunny leaves, against brute force and
+ *                  against growing the FOOT stencil until it holds k leaves
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:20:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include <random>
+#include <thread>
+
+using namespace std;
+
+#define NUM_QUERIES 20000
+#define NUM_BRUTE 500           // Queries also answered by brute force
+#define MAX_STENCIL_FOOT 8
+
+double distance2(const double *p, const double *q)
+{
+    double total = 0;
+    for (int j = 0; j < NDIM; j++)
+        total += (p[j] - q[j]) * (p[j] - q[j]);
+    return total;
+}
+
+/* Every leaf, sorted by (distance, index); the first k */
+void brute_knn(OctreeGraph &graph, const double *query, int k, vector<OctreePoint *> &out)
+{
+    vector<pair<double, int> > all(graph.getNumVertices());
+    for (int i = 0; i < graph.getNumVertices(); i++)
+        all[i] = make_pair(distance2(graph.getVertex(i)->getLocation(), query), i);
+    k = min(k, (int) all.size());
+    partial_sort(all.begin(), all.begin() + k, all.end());
+
+    out.resize(k);
+    for (int i = 0; i < k; i++)
+        out[i] = graph.getVertex(all[i].second);
+}
+
+/*
+ * The stencil alternative: the (2*foot+1)^3 voxels around the query's voxel, looked up
+ * as findNeighbors does (one sorted descent), foot growing until k leaves are found;
+ * the k nearest of those.  Not exact: a cube of voxels is not a ball of leaves.
+ */
+void stencil_knn(Octree &tree, const double *query, int k, vector<OctreePoint *> &out,
+                 long &codes_visited)
+{
+    const double *limits = tree.getLimits();
+    long loc_max = 1l << tree.max_depth, center[NDIM];
+    for (int j = 0; j < NDIM; j++)
+    {
+        double dx = (limits[2 * j + 1] - limits[2 * j]) / loc_max;
+        center[j] = min(max((long) floor((query[j] - limits[2 * j]) / dx), 0l), loc_max - 1);
+    }
+
+    out.clear();
+    for (int foot = 1; foot <= MAX_STENCIL_FOOT && (int) out.size() < k; foot++)
+    {
+        int diam = 2 * foot + 1, nnei = diam * diam * diam;
+        PointBuffer pb;
+        for (int i = 0; i < nnei; i++)
+        {
+            long location[NDIM];
+            bool inside = true;
+            for (int j = 0, offset = i; j < NDIM; j++, offset /= diam)
+            {
+                location[j] = center[j] + (offset % diam) - foot;
+                inside = inside && location[j] >= 0 && location[j] < loc_max;
+            }
+            if (inside)
+                pb.emplace_back(location, tree.max_depth);
+        }
+        codes_visited += pb.size();
+        sortPoints(pb, tree.max_depth);
+        out.clear();
+        tree.findPoints(pb.begin(), pb.end(), out, false);
+    }
+
+    vector<pair<double, OctreePoint *> > found(out.size());
+    for (unsigned int i = 0; i < out.size(); i++)
+        found[i] = make_pair(distance2(out[i]->getLocation(), query), out[i]);
+    sort(found.begin(), found.end());
+    out.resize(min(k, (int) found.size()));
+    for (unsigned int i = 0; i < out.size(); i++)
+        out[i] = found[i].second;
+}
+
+int main(int argc, char **argv)
+{
+    int k = (argc > 1) ? atoi(argv[1]) : 16;
+    vector<double> points;
+    vector<float> normals;
+    long num_points = read_cloud(example_cloud(), points, normals);
+    if (num_points < 0)
+        return -1;
+
+    QuietCout quiet;
+
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    tree.insertPoints(&points[0], NULL, num_points, graph);
+    quiet.restore();
+
+    /* Queries: leaf locations jittered by about a voxel */
+    const double *limits = tree.getLimits();
+    double voxel = (limits[1] - limits[0]) / (1 << DEPTH);
+    mt19937 rng(7);
+    uniform_int_distribution<int> pick(0, graph.getNumVertices() - 1);
+    normal_distribution<double> jitter(0, voxel);
+    vector<double> queries(NDIM * NUM_QUERIES);
+    for (int q = 0; q < NUM_QUERIES; q++)
+    {
+        const double *base = graph.getVertex(pick(rng))->getLocation();
+        for (int j = 0; j < NDIM; j++)
+            queries[NDIM * q + j] = base[j] + jitter(rng);
+    }
+
+    /* Brute force on the first NUM_BRUTE */
+    vector<vector<OctreePoint *> > exact(NUM_BRUTE);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for (int q = 0; q < NUM_BRUTE; q++)
+        brute_knn(graph, &queries[NDIM * q], k, exact[q]);
+    double t_brute = seconds_since(start) / NUM_BRUTE;
+
+    /* Single queries */
+    vector<vector<OctreePoint *> > single(NUM_QUERIES);
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < NUM_QUERIES; q++)
+        tree.knn(&queries[NDIM * q], k, single[q]);
+    double t_single = seconds_since(start) / NUM_QUERIES;
+
+    /* Batches, serial and on every core */
+    vector<OctreePoint *> batch;
+    NUM_THREADS = 1;
+    start = chrono::steady_clock::now();
+    tree.knnBatch(&queries[0], NUM_QUERIES, k, batch);
+    double t_batch = seconds_since(start) / NUM_QUERIES;
+
+    int cores = max(1u, thread::hardware_concurrency());
+    vector<OctreePoint *> batch_parallel;
+    NUM_THREADS = cores;
+    start = chrono::steady_clock::now();
+    tree.knnBatch(&queries[0], NUM_QUERIES, k, batch_parallel);
+    double t_parallel = seconds_since(start) / NUM_QUERIES;
+    NUM_THREADS = 1;
+
+    /* Stencil */
+    vector<vector<OctreePoint *> > stencil(NUM_QUERIES);
+    long codes_visited = 0;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < NUM_QUERIES; q++)
+        stencil_knn(tree, &queries[NDIM * q], k, stencil[q], codes_visited);
+    double t_stencil = seconds_since(start) / NUM_QUERIES;
+
+    /* Agreement */
+    int brute_mismatches = 0, batch_mismatches = 0;
+    for (int q = 0; q < NUM_BRUTE; q++)
+        brute_mismatches += (single[q] != exact[q]);
+    for (int q = 0; q < NUM_QUERIES; q++)
+    {
+        vector<OctreePoint *> from_batch(batch.begin() + q * k, batch.begin() + (q + 1) * k),
+                              from_parallel(batch_parallel.begin() + q * k,
+                                            batch_parallel.begin() + (q + 1) * k);
+        batch_mismatches += (from_batch != single[q]) + (from_parallel != single[q]);
+    }
+
+    long stencil_hits = 0;
+    for (int q = 0; q < NUM_QUERIES; q++)
+        for (unsigned int i = 0; i < stencil[q].size(); i++)
+            stencil_hits += count(single[q].begin(), single[q].end(), stencil[q][i]);
+
+    cout << "\n" << graph.getNumVertices() << " leaves, " << NUM_QUERIES << " queries, k = "
+         << k << " (microseconds per query):\n" << fixed << setprecision(2)
+         << setw(30) << "brute force" << setw(10) << 1e6 * t_brute << "\n"
+         << setw(30) << "knn" << setw(10) << 1e6 * t_single << "\n"
+         << setw(30) << "knnBatch, 1 thread" << setw(10) << 1e6 * t_batch << "\n"
+         << setw(30) << "knnBatch, " + to_string(cores) + " threads" << setw(10)
+         << 1e6 * t_parallel << "\n"
+         << setw(30) << "growing FOOT stencil" << setw(10) << 1e6 * t_stencil
+         << "  (" << codes_visited / (double) NUM_QUERIES << " codes per query, recall "
+         << setprecision(4) << stencil_hits / (double) NUM_QUERIES / k << ")\n"
+         << "knn vs brute force: " << brute_mismatches << " of " << NUM_BRUTE
+         << " differ; knnBatch vs knn: " << batch_mismatches << " differ" << endl;
+
+    return check_status(brute_mismatches + batch_mismatches);
+}
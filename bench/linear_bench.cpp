@@ -0,0 +1,206 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  linear_bench.cpp
+ *
+ *    Description:  The pointer Octree against the LinearOctree backend on a synthetic
+ *                  surface, at a shallow depth with many points per leaf and at deep
+ *                  levels with about one: memory, build, point lookup and neighbor
+ *                  lookup, and a leaf-for-leaf agreement check between the two
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 05:21:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "cloud_gen.h"
+#include "linear_octree.h"
+#include <string.h>
+
+using namespace std;
+
+/*
+ * Timings of one backend at one depth.  Memory is what holds the leaves and the
+ * structure over them: the pooled nodes, leaves and child arrays plus the vertex list
+ * for Octree, the sorted arrays for LinearOctree.  Neighbor lookup fills the list of
+ * every leaf; for Octree that is computeEdges, which also makes the edges.
+ */
+struct BackendResult
+{
+    int leaves;
+    size_t bytes;
+    double build_ms, find_ns, neighbor_ms;
+    long neighbors;
+};
+
+void print_row(int depth, const char *backend, const BackendResult &r)
+{
+    cout << setw(6) << depth << setw(9) << backend << setw(10) << r.leaves
+         << setw(12) << r.bytes / 1024 << setw(8) << r.bytes / max(r.leaves, 1)
+         << setw(11) << setprecision(4) << r.build_ms << setw(11) << r.find_ns
+         << setw(13) << r.neighbor_ms << setw(12) << r.neighbors << endl;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  long count_disagreements(...)
+ *  Description:  Leaves, point lookups and neighbor lists on which the two backends
+ *                  differ.  Both number their leaves in code order, so leaf i of one
+ *                  must be leaf i of the other.
+ * =====================================================================================
+ */
+long count_disagreements(OctreeGraph &graph, const vector<int> &pointer_found,
+                         const LinearOctree &linear, const vector<int> &linear_found)
+{
+    if (graph.getNumVertices() != linear.getNumLeaves())
+        return 1;
+
+    long failures = 0;
+    vector<int> neighbors;
+    for (int i = 0; i < linear.getNumLeaves(); i++)
+    {
+        OctreePoint *p = graph.getVertex(i);
+        bool same = p->getAddress() == linear.getAddress(i)
+                    && p->getNumPoints() == linear.getNumPoints(i)
+                    && memcmp(p->getLocation(), linear.getLocation(i),
+                              NDIM * sizeof(double)) == 0;
+
+        linear.findNeighbors(i, neighbors);
+        vector<OctreePoint *> &expected = p->getNeighbors();
+        same = same && expected.size() == neighbors.size();
+        for (unsigned int n = 0; same && n < neighbors.size(); n++)
+            same = expected[n]->getIndex() == neighbors[n];
+
+        failures += !same;
+    }
+
+    for (unsigned int q = 0; q < pointer_found.size(); q++)
+        failures += (pointer_found[q] != linear_found[q]);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    long n = 200000;
+    vector<int> depths;
+    const char *backend = "both";
+    if (argc > 1)
+        n = atol(argv[1]);
+    if (argc > 2)
+        depths.push_back(atoi(argv[2]));
+    else
+    {
+        depths.push_back(6);        // Dense: dozens of points per leaf
+        depths.push_back(12);
+        depths.push_back(14);
+        depths.push_back(16);
+    }
+    if (argc > 3)
+        backend = argv[3];
+
+    bool run_pointer = strcmp(backend, "pointer") == 0 || strcmp(backend, "both") == 0,
+         run_linear = strcmp(backend, "linear") == 0 || strcmp(backend, "both") == 0;
+    if (!run_pointer && !run_linear)
+    {
+        cerr << "usage: linear_bench [points] [depth] [pointer|linear|both]" << endl;
+        return 1;
+    }
+
+    init_globals();
+    vector<double> points(NDIM * n);
+    generate_cloud(CLOUD_SURFACE, n, &points[0]);
+
+    cout << n << " surface points, FOOT " << FOOT << ":\n"
+         << setw(6) << "depth" << setw(9) << "backend" << setw(10) << "leaves"
+         << setw(12) << "KB" << setw(8) << "B/leaf" << setw(11) << "build ms"
+         << setw(11) << "find ns" << setw(13) << "neighbor ms" << setw(12) << "neighbors"
+         << endl;
+
+    long failures = 0;
+    for (unsigned int d = 0; d < depths.size(); d++)
+    {
+        int depth = depths[d];
+        BackendResult r;
+        chrono::steady_clock::time_point start;
+
+        /* Pointer tree */
+        Octree tree(CLOUD_LIMITS, depth);
+        OctreeGraph graph;
+        vector<int> pointer_found;
+        if (run_pointer)
+        {
+            QuietCout quiet;
+            start = chrono::steady_clock::now();
+            tree.insertPoints(&points[0], NULL, n, graph);
+            r.build_ms = ms_since(start);
+            r.leaves = graph.getNumVertices();
+            r.bytes = tree.bytesUsed()
+                      + graph.getVertices().capacity() * sizeof(OctreePoint *);
+
+            pointer_found.resize(n);
+            start = chrono::steady_clock::now();
+            for (long i = 0; i < n; i++)
+            {
+                OctreePoint *p = tree.findPoint(&points[NDIM * i]);
+                pointer_found[i] = (p == NULL) ? -1 : p->getIndex();
+            }
+            r.find_ns = 1e6 * ms_since(start) / n;
+
+            start = chrono::steady_clock::now();
+            graph.computeEdges();
+            r.neighbor_ms = ms_since(start);
+            r.neighbors = 0;
+            for (int i = 0; i < r.leaves; i++)
+                r.neighbors += graph.getVertex(i)->getNeighbors().size();
+            quiet.restore();
+            print_row(depth, "pointer", r);
+        }
+
+        /* Sorted leaf array */
+        LinearOctree linear(CLOUD_LIMITS, depth);
+        vector<int> linear_found;
+        if (run_linear)
+        {
+            start = chrono::steady_clock::now();
+            linear.addPoints(&points[0], NULL, n);
+            r.build_ms = ms_since(start);
+            r.leaves = linear.getNumLeaves();
+            r.bytes = linear.memoryUsage();
+
+            linear_found.resize(n);
+            start = chrono::steady_clock::now();
+            for (long i = 0; i < n; i++)
+                linear_found[i] = linear.findPoint(&points[NDIM * i]);
+            r.find_ns = 1e6 * ms_since(start) / n;
+
+            vector<int> neighbors;
+            start = chrono::steady_clock::now();
+            r.neighbors = 0;
+            for (int i = 0; i < r.leaves; i++)
+            {
+                linear.findNeighbors(i, neighbors);
+                r.neighbors += neighbors.size();
+            }
+            r.neighbor_ms = ms_since(start);
+            print_row(depth, "linear", r);
+        }
+
+        if (run_pointer && run_linear)
+        {
+            long disagree = count_disagreements(graph, pointer_found, linear,
+                                                linear_found);
+            if (disagree != 0)
+                cout << "depth " << depth << ": backends disagree on " << disagree
+                     << " leaves or lookups\n";
+            failures += disagree;
+        }
+    }
+
+    return check_status(failures);
+}
@@ -0,0 +1,102 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  morton_bench.cpp
+ *
+ *    Description:  Throughput of each Morton codec path, checked against the bit loop
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:40:18 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "morton.h"
+#include <cstring>
+
+using namespace std;
+
+volatile codestring sink;    // keeps the single-point loop from being optimized away
+
+/* Time one path at one depth and compare its output with the reference */
+bool bench_path(morton_enum path, int n, int depth, const vector<long> &locations,
+                const vector<codestring> &ref_codes, const vector<long> &ref_locations)
+{
+    if (!setMortonPath(path))
+    {
+        cout << setw(8) << mortonPathName(path) << "  (not supported on this CPU)\n";
+        return true;
+    }
+
+    vector<codestring> codes(n);
+    vector<long> decoded(NDIM * n);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    mortonEncode(n, &locations[0], &codes[0], depth);
+    double t_batch_enc = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    mortonDecode(n, &codes[0], &decoded[0], depth);
+    double t_batch_dec = seconds_since(start);
+
+    /* Single-point entry point, as used by the CodedPoint constructors */
+    codestring checksum = 0;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < n; i++)
+        checksum ^= locationToCode(&locations[NDIM * i], depth);
+    double t_single_enc = seconds_since(start);
+    sink = checksum;
+
+    bool exact = (codes == ref_codes) && (decoded == ref_locations);
+
+    cout << setw(8) << mortonPathName(path)
+         << setw(14) << (long) (n / t_batch_enc)
+         << setw(14) << (long) (n / t_batch_dec)
+         << setw(14) << (long) (n / t_single_enc)
+         << "  " << (exact ? "exact" : "MISMATCH") << endl;
+
+    return exact;
+}
+
+int main(int argc, char **argv)
+{
+    int n = 1 << 22;
+    if (argc > 1)
+        n = atoi(argv[1]);
+
+    const int depths[] = {8, 12, MORTON_MAX_DEPTH};
+    const morton_enum paths[] = {MORTON_LOOP, MORTON_MAGIC, MORTON_TABLE, MORTON_BMI2};
+    bool all_exact = true;
+
+    srand(1);
+    for (unsigned int d = 0; d < sizeof(depths) / sizeof(int); d++)
+    {
+        int depth = depths[d];
+        long loc_max = 1l << depth;
+
+        vector<long> locations(NDIM * n);
+        for (int i = 0; i < NDIM * n; i++)
+            locations[i] = ((((long) rand()) << 16) ^ rand()) % loc_max;
+
+        /* Reference output from the bit loop */
+        setMortonPath(MORTON_LOOP);
+        vector<codestring> ref_codes(n);
+        vector<long> ref_locations(NDIM * n);
+        mortonEncode(n, &locations[0], &ref_codes[0], depth);
+        mortonDecode(n, &ref_codes[0], &ref_locations[0], depth);
+
+        cout << "\nDepth " << depth << ", " << n << " codes (codes/second):\n";
+        cout << setw(8) << "path" << setw(14) << "batch enc" << setw(14) << "batch dec"
+             << setw(14) << "single enc" << endl;
+        for (unsigned int p = 0; p < sizeof(paths) / sizeof(morton_enum); p++)
+            all_exact = bench_path(paths[p], n, depth, locations, ref_codes, ref_locations)
+                        && all_exact;
+    }
+
+    return check_status(!all_exact);
+}
@@ -0,0 +1,217 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  occupancy_bench.cpp
+ *
+ *    Description:  Size and rebuild time of the occupancy stream of the bunny leaves,
+ *                  against an ASCII PLY of the same leaves and against addPoints
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 06:52:30 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "occupancy.h"
+
+using namespace std;
+
+#define TRIALS 5    // Repeats of the structure-only builds
+
+/* Size of the leaves written as an ASCII PLY with normals, as visualize.h writes them */
+size_t ascii_ply_size(OctreeGraph &graph, int depth)
+{
+    ostringstream out;
+    out << "ply\nformat ascii 1.0\nelement vertex " << graph.getNumVertices() << "\n"
+        << "property float x\nproperty float y\nproperty float z\n"
+        << "property float nx\nproperty float ny\nproperty float nz\nend_header\n";
+
+    int prec = ceil(.75 * depth);
+    out << setprecision(prec) << fixed;
+    for (int i = 0; i < graph.getNumVertices(); i++)
+    {
+        OctreePoint *p = graph.getVertex(i);
+        for (int j = 0; j < NDIM; j++)
+            out << (float) p->getLocation()[j] << " ";
+        for (int j = 0; j < NDIM; j++)
+            out << p->getNormal()[j] << (j < NDIM - 1 ? " " : "\n");
+    }
+    return out.str().size();
+}
+
+/* Streams whose header claims a depth beyond MORTON_MAX_DEPTH, or an unknown flag, that
+ * readOccupancy accepts nonetheless */
+int count_accepted_headers(const string &stream)
+{
+    const int DEPTH_BYTE = 7, FLAGS_BYTE = 8, NUM_CORRUPTIONS = 3;
+    int accepted = 0;
+    for (int c = 0; c < NUM_CORRUPTIONS; c++)
+    {
+        string bad = stream;
+        switch (c)
+        {
+            case 0: bad[DEPTH_BYTE] = MORTON_MAX_DEPTH + 1; break;
+            case 1: bad[DEPTH_BYTE] = 40; break;            // 1 << depth overflows
+            case 2: bad[FLAGS_BYTE] |= 0x80; break;
+        }
+        QuietCout quiet;
+        istringstream input(bad);
+        OccupancyLeaves leaves;
+        accepted += readOccupancy(input, leaves);
+    }
+    return accepted;
+}
+
+int main(int argc, char **argv)
+{
+    string filename = example_cloud();
+
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    if (!load_points_from_pxx(filename.c_str(), tree, graph))
+        return -1;
+    graph.computeNormals();
+
+    /* Raw points again, to time addPoints alone */
+    vector<double> points;
+    vector<float> normals;
+    long num_points = read_cloud(filename, points, normals);
+    QuietCout quiet;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Octree raw_tree(LIMS, DEPTH);
+    OctreeGraph raw_graph;
+    raw_tree.addPoints(&points[0], NULL, num_points, raw_graph);
+    double t_add = seconds_since(start);
+    quiet.restore();
+
+    start = chrono::steady_clock::now();
+    ostringstream encoded;
+    writeOccupancy(encoded, tree, graph);
+    double t_encode = seconds_since(start);
+    string stream = encoded.str();
+
+    start = chrono::steady_clock::now();
+    istringstream input(stream);
+    Octree decoded_tree(LIMS, DEPTH);
+    OctreeGraph decoded_graph;
+    if (!readOccupancy(input, decoded_tree, decoded_graph))
+        return -1;
+    double t_decode = seconds_since(start);
+
+    /* Structure only: decoding alone, then each way of building the tree */
+    start = chrono::steady_clock::now();
+    istringstream leaves_input(stream);
+    OccupancyLeaves leaves;
+    readOccupancy(leaves_input, leaves);
+    double t_read = seconds_since(start);
+
+    /* Best of TRIALS, so the first touch of fresh pool pages does not decide the order */
+    double t_insert = HUGE_VAL, t_leaves = HUGE_VAL, t_masks = HUGE_VAL;
+    quiet.quiet();
+    for (int trial = 0; trial < TRIALS; trial++)
+    {
+        start = chrono::steady_clock::now();
+        {
+            Octree insert_tree(LIMS, DEPTH);
+            OctreeGraph insert_graph;
+            insert_tree.insertPoints(&points[0], NULL, num_points, insert_graph);
+        }
+        t_insert = min(t_insert, seconds_since(start));
+
+        start = chrono::steady_clock::now();
+        {
+            Octree leaves_tree(leaves.limits, leaves.max_depth);
+            OctreeGraph leaves_graph;
+            leaves_tree.insertLeaves(&leaves.codes[0], &leaves.locations[0],
+                                     &leaves.normals[0], &leaves.num_points[0],
+                                     leaves.codes.size(), leaves_graph);
+        }
+        t_leaves = min(t_leaves, seconds_since(start));
+
+        start = chrono::steady_clock::now();
+        {
+            Octree masks_tree(leaves.limits, leaves.max_depth);
+            OctreeGraph masks_graph;
+            masks_tree.insertMasks(&leaves.masks[0], leaves.masks.size(),
+                                   &leaves.locations[0], &leaves.normals[0],
+                                   &leaves.num_points[0], leaves.codes.size(),
+                                   masks_graph);
+        }
+        t_masks = min(t_masks, seconds_since(start));
+    }
+    quiet.restore();
+
+    Octree leaves_tree(leaves.limits, leaves.max_depth);
+    OctreeGraph leaves_graph;
+    leaves_tree.insertLeaves(&leaves.codes[0], &leaves.locations[0], &leaves.normals[0],
+                             &leaves.num_points[0], leaves.codes.size(), leaves_graph);
+    Octree masks_tree(leaves.limits, leaves.max_depth);
+    OctreeGraph masks_graph;
+    masks_tree.insertMasks(&leaves.masks[0], leaves.masks.size(), &leaves.locations[0],
+                           &leaves.normals[0], &leaves.num_points[0],
+                           leaves.codes.size(), masks_graph);
+
+    /* The tree from the masks must hold the same leaves, and find each by location */
+    int disagree = (masks_graph.getNumVertices() != leaves_graph.getNumVertices());
+    for (int i = 0; i < masks_graph.getNumVertices() && !disagree; i++)
+    {
+        OctreePoint *p = leaves_graph.getVertex(i), *q = masks_graph.getVertex(i);
+        if (p->getAddress() != q->getAddress() || p->getNumPoints() != q->getNumPoints()
+            || masks_tree.findPoint(q->getLocation()) != q)
+            disagree++;
+    }
+
+    /* Quantization error, matching leaves by address */
+    double max_offset = 0, max_angle = 0;
+    int missing = 0;
+    for (int i = 0; i < decoded_graph.getNumVertices(); i++)
+    {
+        OctreePoint *q = decoded_graph.getVertex(i), *p = tree.findPoint(q->getLocation());
+        if (p == NULL || p->getAddress() != q->getAddress()
+            || decoded_tree.findPoint(q->getLocation()) != q)
+        {
+            missing++;
+            continue;
+        }
+        for (int j = 0; j < NDIM; j++)
+            max_offset = max(max_offset, fabs(p->getLocation()[j] - q->getLocation()[j]));
+        double dot = 0;
+        for (int j = 0; j < NDIM; j++)
+            dot += p->getNormal()[j] * q->getNormal()[j];
+        if (dot == dot)
+            max_angle = max(max_angle, acos(min(1.0, dot)) * 180 / M_PI);
+    }
+
+    size_t ascii = ascii_ply_size(graph, DEPTH);
+    cout << "\n" << graph.getNumVertices() << " leaves at depth " << DEPTH << ":\n"
+         << setw(28) << "ASCII PLY of leaves" << setw(12) << ascii << " bytes\n"
+         << setw(28) << "occupancy stream" << setw(12) << stream.size() << " bytes ("
+         << setprecision(3) << ascii / (double) stream.size() << "x smaller)\n"
+         << setw(28) << "encode" << setw(12) << 1000 * t_encode << " ms\n"
+         << setw(28) << "decode and rebuild" << setw(12) << 1000 * t_decode << " ms\n"
+         << setw(28) << "addPoints from raw points" << setw(12) << 1000 * t_add << " ms\n"
+         << setw(28) << "decode only" << setw(12) << 1000 * t_read << " ms\n"
+         << setw(28) << "then insertLeaves" << setw(12) << 1000 * t_leaves
+         << " ms (no edges, best of " << TRIALS << ")\n"
+         << setw(28) << "then insertMasks" << setw(12) << 1000 * t_masks
+         << " ms (no edges, best of " << TRIALS << ")\n"
+         << setw(28) << "insertPoints from raw" << setw(12) << 1000 * t_insert
+         << " ms (no edges, best of " << TRIALS << ")\n"
+         << "rebuilt " << decoded_graph.getNumVertices() << " leaves (" << missing
+         << " misplaced), " << decoded_graph.getNumEdges() << " edges; largest position error "
+         << max_offset << ", largest normal error " << max_angle << " degrees; "
+         << "insertMasks and insertLeaves " << (disagree ? "DISAGREE" : "agree") << endl;
+
+    int accepted = count_accepted_headers(stream);
+    cout << accepted << " damaged headers accepted" << endl;
+
+    return check_status(missing + disagree + accepted
+                        + (decoded_graph.getNumVertices() != graph.getNumVertices())
+                        + (decoded_graph.getNumEdges() != graph.getNumEdges()));
+}
@@ -0,0 +1,156 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  radius_bench.cpp
+ *
+ *    Description:  Metric radius search on the bunny leaves against the FOOT stencil,
+ *                  and the normals each neighborhood gives
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:51:19 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+
+using namespace std;
+
+#define NUM_BRUTE 300           // Queries also answered by brute force
+
+double distance(const double *p, const double *q)
+{
+    double total = 0;
+    for (int j = 0; j < NDIM; j++)
+        total += (p[j] - q[j]) * (p[j] - q[j]);
+    return sqrt(total);
+}
+
+int main(int argc, char **argv)
+{
+    vector<double> points;
+    vector<float> normals;
+    long num_points = read_cloud(example_cloud(), points, normals);
+    if (num_points < 0)
+        return -1;
+
+    QuietCout quiet;
+
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    tree.insertPoints(&points[0], NULL, num_points, graph);
+
+    /* A ball as wide as the stencil's inscribed sphere */
+    const double *limits = tree.getLimits();
+    double voxel = (limits[1] - limits[0]) / (1 << DEPTH),
+           radius = FOOT * voxel;
+    int num_vertices = graph.getNumVertices();
+
+    vector<double> centers(NDIM * num_vertices);
+    for (int i = 0; i < num_vertices; i++)
+        for (int j = 0; j < NDIM; j++)
+            centers[NDIM * i + j] = graph.getVertex(i)->getLocation()[j];
+
+    /* Stencil neighborhoods and normals */
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    graph.computeEdges();
+    double t_stencil = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    graph.computeNormals();
+    double t_stencil_normals = seconds_since(start);
+
+    vector<float> stencil_normals(NDIM * num_vertices);
+    long stencil_total = 0;
+    double stencil_reach = 0;
+    for (int i = 0; i < num_vertices; i++)
+    {
+        OctreePoint *p = graph.getVertex(i);
+        stencil_total += p->getNeighbors().size();
+        for (unsigned int n = 0; n < p->getNeighbors().size(); n++)
+            stencil_reach = max(stencil_reach, distance(p->getLocation(),
+                                                        p->getNeighbor(n)->getLocation()));
+        for (int j = 0; j < NDIM; j++)
+            stencil_normals[NDIM * i + j] = p->getNormal()[j];
+    }
+
+    /* Radius searches */
+    vector<OctreePoint *> around;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < num_vertices; i++)
+        tree.radiusSearch(&centers[NDIM * i], radius, around);
+    double t_single = seconds_since(start);
+
+    vector<long> offsets;
+    vector<OctreePoint *> rows;
+    start = chrono::steady_clock::now();
+    tree.radiusSearchBatch(&centers[0], num_vertices, radius, offsets, rows);
+    double t_batch = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    graph.computeNormals(tree, radius);
+    double t_metric_normals = seconds_since(start);
+    quiet.restore();
+
+    /* Agreement: single against batch, and against brute force */
+    int batch_mismatches = 0, brute_mismatches = 0;
+    for (int i = 0; i < num_vertices; i++)
+    {
+        tree.radiusSearch(&centers[NDIM * i], radius, around);
+        batch_mismatches += !equal(around.begin(), around.end(), rows.begin() + offsets[i])
+                            || (long) around.size() != offsets[i + 1] - offsets[i];
+
+        if (i < NUM_BRUTE)
+        {
+            vector<OctreePoint *> brute;
+            for (int v = 0; v < num_vertices; v++)
+                if (distance(graph.getVertex(v)->getLocation(), &centers[NDIM * i]) <= radius)
+                    brute.push_back(graph.getVertex(v));
+            sort(brute.begin(), brute.end());
+            sort(around.begin(), around.end());
+            brute_mismatches += (brute != around);
+        }
+    }
+
+    /* Normals: angle between the stencil and metric estimates (sign-free) */
+    double total_angle = 0;
+    int num_defined = 0;
+    for (int i = 0; i < num_vertices; i++)
+    {
+        const float *metric = graph.getVertex(i)->getNormal();
+        double dot = 0;
+        for (int j = 0; j < NDIM; j++)
+            dot += metric[j] * stencil_normals[NDIM * i + j];
+        if (dot == dot)
+        {
+            total_angle += acos(min(1.0, fabs(dot))) * 180 / M_PI;
+            num_defined++;
+        }
+    }
+
+    cout << "\n" << num_vertices << " leaves, FOOT = " << FOOT << ", radius = FOOT voxels = "
+         << radius << ":\n" << fixed << setprecision(2)
+         << setw(34) << "stencil codes per vertex" << setw(10) << NNEI - 1 << "\n"
+         << setw(34) << "stencil leaves per vertex" << setw(10)
+         << stencil_total / (double) num_vertices << "  (farthest at "
+         << stencil_reach / voxel << " voxels)\n"
+         << setw(34) << "ball leaves per vertex" << setw(10)
+         << rows.size() / (double) num_vertices << "  (at most " << FOOT << " voxels)\n"
+         << setw(34) << "computeEdges (stencil)" << setw(10) << 1000 * t_stencil << " ms\n"
+         << setw(34) << "radiusSearch, one at a time" << setw(10) << 1000 * t_single << " ms\n"
+         << setw(34) << "radiusSearchBatch" << setw(10) << 1000 * t_batch << " ms\n"
+         << setw(34) << "computeNormals (stencil)" << setw(10) << 1000 * t_stencil_normals
+         << " ms\n"
+         << setw(34) << "computeNormals (radius)" << setw(10) << 1000 * t_metric_normals
+         << " ms  (search included)\n"
+         << "mean angle between the two normals: " << total_angle / max(num_defined, 1)
+         << " degrees\n"
+         << "batch vs single: " << batch_mismatches << " differ; single vs brute force: "
+         << brute_mismatches << " of " << NUM_BRUTE << " differ" << endl;
+
+    return check_status(batch_mismatches + brute_mismatches);
+}
@@ -0,0 +1,144 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  slot_bench.cpp
+ *
+ *    Description:  Relative-neighbor lookups through the dense stencil slots against
+ *                  OctreePoint::getNeighbor, as an MRF pairwise term would make them
+ *
+ *        Version:  1.0
+ *        Created:  10/18/2026 12:14:52 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "stencil.h"
+
+using namespace std;
+
+#define LOOKUP_PASSES 20        // Passes over every vertex's face neighbors
+
+// The six face neighbors, the usual pairwise clique of an MRF on the grid
+const int FACE_OFFSETS[2 * NDIM][NDIM] = {{-1, 0, 0}, {1, 0, 0}, {0, -1, 0},
+                                          {0, 1, 0}, {0, 0, -1}, {0, 0, 1}};
+
+/* Every offset of the stencil and a ring beyond it, slots against the scan */
+int count_mismatches(OctreeGraph &graph)
+{
+    int mismatches = 0;
+    for (int i = 0; i < graph.getNumVertices(); i++)
+    {
+        OctreePoint *p = graph.getVertex(i);
+        int relative_coords[NDIM];
+        for (relative_coords[2] = -FOOT - 1; relative_coords[2] <= FOOT + 1; relative_coords[2]++)
+            for (relative_coords[1] = -FOOT - 1; relative_coords[1] <= FOOT + 1; relative_coords[1]++)
+                for (relative_coords[0] = -FOOT - 1; relative_coords[0] <= FOOT + 1; relative_coords[0]++)
+                    mismatches += graph.getNeighbor(i, relative_coords)
+                                  != p->getNeighbor(relative_coords);
+    }
+    return mismatches;
+}
+
+int main(int argc, char **argv)
+{
+    vector<double> points;
+    vector<float> normals;
+    long num_points = read_cloud(example_cloud(), points, normals);
+    if (num_points < 0)
+        return -1;
+
+    QuietCout quiet;
+
+    /* The same leaves, with and without slots */
+    Octree plain_tree(LIMS, DEPTH), tree(LIMS, DEPTH);
+    OctreeGraph plain_graph, graph(true, true);
+    plain_tree.addPoints(&points[0], NULL, num_points, plain_graph);
+    tree.addPoints(&points[0], NULL, num_points, graph);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    plain_graph.computeEdges();
+    double t_plain = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    graph.computeEdges();
+    double t_slots = seconds_since(start);
+
+    EDGE_SWEEP = 1;
+    OctreeGraph sweep_graph(true, true);
+    Octree sweep_tree(LIMS, DEPTH);
+    sweep_tree.addPoints(&points[0], NULL, num_points, sweep_graph);
+    start = chrono::steady_clock::now();
+    sweep_graph.computeEdges();
+    double t_sweep = seconds_since(start);
+    EDGE_SWEEP = 0;
+
+    /* Two batches: the second brings the slots up to date through updateEdges */
+    OctreeGraph update_graph(true, true);
+    Octree update_tree(LIMS, DEPTH);
+    int half = num_points / 2;
+    update_tree.addPoints(&points[0], NULL, half, update_graph);
+    update_tree.addPoints(&points[NDIM * half], NULL, num_points - half, update_graph);
+    quiet.restore();
+
+    int num_vertices = graph.getNumVertices();
+    int mismatches = count_mismatches(graph), sweep_mismatches = count_mismatches(sweep_graph),
+        update_mismatches = count_mismatches(update_graph);
+
+    /* Face-neighbor lookups */
+    long found_scan = 0, found_index = 0, found_slot = 0;
+    start = chrono::steady_clock::now();
+    for (int pass = 0; pass < LOOKUP_PASSES; pass++)
+        for (int i = 0; i < num_vertices; i++)
+            for (int f = 0; f < 2 * NDIM; f++)
+                found_scan += graph.getVertex(i)->getNeighbor(FACE_OFFSETS[f]) != NULL;
+    double t_scan = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    for (int pass = 0; pass < LOOKUP_PASSES; pass++)
+        for (int i = 0; i < num_vertices; i++)
+            for (int f = 0; f < 2 * NDIM; f++)
+                found_index += graph.getNeighborIndex(i, FACE_OFFSETS[f]) >= 0;
+    double t_index = seconds_since(start);
+
+    int face_slots[2 * NDIM];
+    for (int f = 0; f < 2 * NDIM; f++)
+        face_slots[f] = stencilSlot(FACE_OFFSETS[f]);
+    start = chrono::steady_clock::now();
+    for (int pass = 0; pass < LOOKUP_PASSES; pass++)
+        for (int i = 0; i < num_vertices; i++)
+        {
+            Span<const int> row = graph.getSlots(i);
+            for (int f = 0; f < 2 * NDIM; f++)
+                found_slot += row[face_slots[f]] >= 0;
+        }
+    double t_slot = seconds_since(start);
+
+    double lookups = (double) LOOKUP_PASSES * num_vertices * 2 * NDIM;
+    cout << "\n" << num_vertices << " leaves, FOOT = " << FOOT << ", "
+         << graph.getNumEdges() << " edges:\n" << fixed << setprecision(1)
+         << setw(36) << "computeEdges" << setw(10) << 1000 * t_plain << " ms\n"
+         << setw(36) << "computeEdges, with slots" << setw(10) << 1000 * t_slots << " ms\n"
+         << setw(36) << "computeEdges (sweep), with slots" << setw(10) << 1000 * t_sweep
+         << " ms\n"
+         << setw(36) << "slot table" << setw(10)
+         << NNEI * sizeof(int) * (double) num_vertices / (1 << 20) << " MB\n"
+         << "face-neighbor lookups (ns each):\n" << setprecision(2)
+         << setw(36) << "OctreePoint::getNeighbor" << setw(10) << 1e9 * t_scan / lookups
+         << "\n"
+         << setw(36) << "OctreeGraph::getNeighborIndex" << setw(10)
+         << 1e9 * t_index / lookups << "\n"
+         << setw(36) << "getSlots row, precomputed slot" << setw(10)
+         << 1e9 * t_slot / lookups << "\n"
+         << "found " << found_scan / LOOKUP_PASSES << " / " << found_index / LOOKUP_PASSES
+         << " / " << found_slot / LOOKUP_PASSES << " face neighbors; slots vs scan: "
+         << mismatches << " differ (" << sweep_mismatches << " after the sweep, "
+         << update_mismatches << " after updateEdges)" << endl;
+
+    return check_status(mismatches + sweep_mismatches + update_mismatches
+                        + (found_index != found_scan) + (found_slot != found_scan));
+}
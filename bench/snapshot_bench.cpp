@@ -0,0 +1,160 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  snapshot_bench.cpp
+ *
+ *    Description:  Time to rebuild the bunny graph from its PLY versus saving and
+ *                  mapping a snapshot of it
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:58:13 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "snapshot.h"
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+/* Whether the snapshot holds the same leaves and adjacency as the graph */
+bool same_contents(OctreeGraph &graph, const OctreeSnapshot &snapshot)
+{
+    if (snapshot.getNumLeaves() != graph.getNumVertices())
+        return false;
+
+    for (int i = 0; i < graph.getNumVertices(); i++)
+    {
+        OctreePoint *p = graph.getVertex(i);
+        int leaf = snapshot.findAddress(p->getAddress());
+        if (leaf < 0 || snapshot.getNumPoints(leaf) != p->getNumPoints()
+            || snapshot.getDegree(leaf) != graph.getDegree(i))
+            return false;
+        for (int j = 0; j < NDIM; j++)
+            if (snapshot.getLocation(leaf)[j] != p->getLocation()[j]
+                || !(snapshot.getNormal(leaf)[j] == p->getNormal()[j]
+                     || p->getNormal()[j] != p->getNormal()[j]))
+                return false;
+
+        Span<const int> adjacent = snapshot.getAdjacent(leaf);
+        for (int k = 0; k < adjacent.size(); k++)
+            if (graph.getVertex(graph.getAdjacent(i)[k])->getAddress()
+                != snapshot.getAddress(adjacent[k]))
+                return false;
+    }
+    return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  int count_accepted_corruptions(const char*)
+ *  Description:  Damage copies of a good snapshot in the ways a truncated or
+ *                  mismatched file would be damaged, and count the copies that open
+ *                  nonetheless
+ * =====================================================================================
+ */
+int count_accepted_corruptions(const char *snapshot_name)
+{
+    ifstream in(snapshot_name, ios::binary);
+    stringstream whole;
+    whole << in.rdbuf();
+    const string good = whole.str();
+    SnapshotHeader header;
+    memcpy(&header, good.data(), sizeof(header));
+    size_t last_offset = header.section_offsets[SECTION_ADJ_OFFSETS]
+                         + sizeof(int64_t) * header.num_leaves;
+
+    const int NUM_CORRUPTIONS = 8;
+    int accepted = 0;
+    string bad_name = string(snapshot_name) + ".bad";
+    for (int c = 0; c < NUM_CORRUPTIONS; c++)
+    {
+        string bad = good;
+        SnapshotHeader *h = (SnapshotHeader *) &bad[0];
+        int64_t *row = (int64_t *) &bad[last_offset];
+        int32_t *neighbor = (int32_t *) &bad[header.section_offsets[SECTION_ADJ_INDICES]];
+        switch (c)
+        {
+            case 0: h->num_leaves++; break;                 // sections too short
+            case 1: h->num_adjacent++; break;               // last offset disagrees
+            case 2: (*row)--; break;                        // ... and the other way
+            case 3: row[-1] = *row + 1; break;              // a row reaching past the end
+            case 4: h->section_offsets[SECTION_ADJ_INDICES] =
+                        h->file_size / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN; break;
+            case 5: bad.resize(bad.size() - SNAPSHOT_ALIGN);  // cut short, size patched
+                    h = (SnapshotHeader *) &bad[0];
+                    h->file_size = bad.size(); break;
+            case 6: neighbor[0] = header.num_leaves; break;  // a neighbor past the leaves
+            case 7: neighbor[header.num_adjacent - 1] = -1; break;
+        }
+        ofstream out(bad_name.c_str(), ios::binary | ios::trunc);
+        out.write(bad.data(), bad.size());
+        out.close();
+
+        QuietCout quiet;
+        OctreeSnapshot snapshot;
+        accepted += snapshot.open(bad_name.c_str());
+    }
+    remove(bad_name.c_str());
+    return accepted;
+}
+
+int main(int argc, char **argv)
+{
+    const char *snapshot_name = "bunny.snap";
+    if (argc > 1)
+        snapshot_name = argv[1];
+
+    string filename = example_cloud();
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    if (!load_points_from_pxx(filename.c_str(), tree, graph))
+        return -1;
+    graph.computeNormals();
+    graph.buildAdjacency(point_distance);
+    double t_build = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    if (!saveSnapshot(snapshot_name, tree, graph))
+        return -1;
+    double t_save = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    OctreeSnapshot snapshot;
+    if (!snapshot.open(snapshot_name))
+        return -1;
+    double t_open = seconds_since(start);
+
+    /* First use: one sweep over every row, which faults the pages in */
+    start = chrono::steady_clock::now();
+    double total_weight = 0;
+    for (int i = 0; i < snapshot.getNumLeaves(); i++)
+    {
+        Span<const float> weights = snapshot.getWeights(i);
+        for (int k = 0; k < weights.size(); k++)
+            total_weight += weights[k];
+    }
+    double t_sweep = seconds_since(start);
+
+    cout << "\n" << snapshot.getNumLeaves() << " leaves, " << snapshot.getNumAdjacent()
+         << " adjacency entries (total weight " << total_weight << ")\n";
+    cout << setw(24) << "rebuild from PLY" << setw(12) << 1000 * t_build << " ms\n"
+         << setw(24) << "save snapshot" << setw(12) << 1000 * t_save << " ms\n"
+         << setw(24) << "map snapshot" << setw(12) << 1000 * t_open << " ms\n"
+         << setw(24) << "first sweep" << setw(12) << 1000 * t_sweep << " ms\n";
+    bool same = same_contents(graph, snapshot);
+    int accepted = count_accepted_corruptions(snapshot_name);
+    cout << "contents " << (same ? "match" : "DIFFER") << "; " << accepted
+         << " damaged copies accepted" << endl;
+
+    return check_status(!same + accepted);
+}
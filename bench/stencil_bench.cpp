@@ -0,0 +1,193 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  stencil_bench.cpp
+ *
+ *    Description:  The stencil kernels compiled for each FOOT against the generic ones,
+ *                  on the bunny leaves, for FOOT = 1 .. STENCIL_MAX_FOOT + 1, and both
+ *                  (and the sweep join) against brute force on small full grids
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:41:05 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "stencil.h"
+#include "morton.h"
+#include <cstring>
+
+using namespace std;
+
+#define CODE_PASSES 5           // Passes over every leaf when timing stencilCodes alone
+#define GRID_MAX_DEPTH 3        // Full grids are checked at depths 1 .. GRID_MAX_DEPTH
+
+struct PathResult
+{
+    double codes_ns, edges_ms, normals_ms;
+    vector<codestring> codes;   // Every leaf's stencil codes, back to back
+    vector<float> normals;
+};
+
+void run_path(stencil_enum path, Octree &tree, OctreeGraph &graph, PathResult &result)
+{
+    setStencilPath(path);
+    int num_vertices = graph.getNumVertices();
+    vector<codestring> out(NNEI);
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    long total = 0;
+    for (int pass = 0; pass < CODE_PASSES; pass++)
+        for (int i = 0; i < num_vertices; i++)
+            total += stencilCodes(graph.getVertex(i)->getAddress(), tree.max_depth, &out[0]);
+    result.codes_ns = 1e9 * seconds_since(start) / (CODE_PASSES * (double) num_vertices);
+
+    result.codes.clear();
+    for (int i = 0; i < num_vertices; i++)
+    {
+        int n = stencilCodes(graph.getVertex(i)->getAddress(), tree.max_depth, &out[0]);
+        result.codes.insert(result.codes.end(), out.begin(), out.begin() + n);
+    }
+
+    start = chrono::steady_clock::now();
+    graph.computeEdges();
+    result.edges_ms = 1000 * seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    graph.computeNormals();
+    result.normals_ms = 1000 * seconds_since(start);
+
+    result.normals.resize(NDIM * num_vertices);
+    for (int i = 0; i < num_vertices; i++)
+        memcpy(&result.normals[NDIM * i], graph.getVertex(i)->getNormal(), sizeof(float) * NDIM);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  int count_grid_errors(int)
+ *  Description:  Build a grid with every voxel occupied and count the leaves whose
+ *                  neighbor list is not the brute-force cube of side DIAM around them.
+ *                  At these depths FOOT reaches the width of the grid, where offsets
+ *                  would wrap all the way around the volume.
+ * =====================================================================================
+ */
+int count_grid_errors(int depth)
+{
+    const double limits[2 * NDIM] = {0, 1, 0, 1, 0, 1};
+    int side = 1 << depth, num_voxels = side * side * side;
+    vector<double> centres;
+    for (int v = 0; v < num_voxels; v++)
+        for (int j = 0, rest = v; j < NDIM; j++, rest /= side)
+            centres.push_back((rest % side + .5) / side);
+
+    Octree tree(limits, depth);
+    OctreeGraph graph;
+    tree.insertPoints(&centres[0], NULL, num_voxels, graph);
+    graph.computeEdges();
+
+    int num_vertices = graph.getNumVertices();
+    vector<long> coords(NDIM * num_vertices);
+    for (int i = 0; i < num_vertices; i++)
+        mortonDecode(graph.getVertex(i)->getAddress(), &coords[NDIM * i], depth);
+
+    int errors = (num_vertices != num_voxels);
+    for (int i = 0; i < num_vertices; i++)
+    {
+        vector<OctreePoint *> expected;
+        for (int v = 0; v < num_vertices; v++)
+        {
+            long reach = 0;
+            for (int j = 0; j < NDIM; j++)
+                reach = max(reach, labs(coords[NDIM * v + j] - coords[NDIM * i + j]));
+            if (v != i && reach <= FOOT)
+                expected.push_back(graph.getVertex(v));
+        }
+        errors += (expected != graph.getVertex(i)->getNeighbors());
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    vector<double> points;
+    vector<float> normals;
+    long num_points = read_cloud(example_cloud(), points, normals);
+    if (num_points < 0)
+        return -1;
+
+    QuietCout quiet;
+
+    Octree tree(LIMS, DEPTH);
+    OctreeGraph graph;
+    tree.insertPoints(&points[0], NULL, num_points, graph);
+    quiet.restore();
+
+    cout << "\n" << graph.getNumVertices() << " leaves, depth " << DEPTH
+         << " (generic / fixed):\n"
+         << setw(6) << "FOOT" << setw(26) << "stencilCodes ns/leaf" << setw(24)
+         << "computeEdges ms" << setw(24) << "computeNormals ms" << setw(10) << "same\n";
+
+    int failures = 0;
+    for (int foot = 1; foot <= STENCIL_MAX_FOOT + 1; foot++)
+    {
+        FOOT = foot;
+        DIAM = 1 + 2 * FOOT;
+        NNEI = DIAM * DIAM * DIAM;
+
+        PathResult generic, compiled;
+        quiet.quiet();
+        run_path(STENCIL_GENERIC, tree, graph, generic);
+        run_path(STENCIL_FIXED, tree, graph, compiled);
+        quiet.restore();
+
+        bool same = generic.codes == compiled.codes
+                    && memcmp(&generic.normals[0], &compiled.normals[0],
+                              sizeof(float) * generic.normals.size()) == 0;
+        failures += !same;
+
+        cout << setw(6) << foot << fixed << setprecision(1)
+             << setw(13) << generic.codes_ns << " /" << setw(9) << compiled.codes_ns
+             << setw(13) << generic.edges_ms << " /" << setw(8) << compiled.edges_ms
+             << setw(13) << generic.normals_ms << " /" << setw(8) << compiled.normals_ms
+             << setw(9) << (same ? "yes" : "NO")
+             << (foot > STENCIL_MAX_FOOT ? "   (no fixed kernel: both generic)" : "")
+             << "\n";
+    }
+
+    cout << "\nfull grids, leaves with wrong neighbors (generic / fixed / sweep):\n" << setw(6) << "FOOT";
+    for (int depth = 1; depth <= GRID_MAX_DEPTH; depth++)
+        cout << setw(19) << "depth " + to_string(depth);
+    cout << "\n";
+    for (int foot = 1; foot <= STENCIL_MAX_FOOT + 1; foot++)
+    {
+        FOOT = foot;
+        DIAM = 1 + 2 * FOOT;
+        NNEI = DIAM * DIAM * DIAM;
+
+        cout << setw(6) << foot;
+        for (int depth = 1; depth <= GRID_MAX_DEPTH; depth++)
+        {
+            quiet.quiet();
+            setStencilPath(STENCIL_GENERIC);
+            int generic = count_grid_errors(depth);
+            setStencilPath(STENCIL_FIXED);
+            int compiled = count_grid_errors(depth);
+            EDGE_SWEEP = 1;
+            int swept = count_grid_errors(depth);
+            EDGE_SWEEP = 0;
+            quiet.restore();
+
+            failures += generic + compiled + swept;
+            cout << setw(9) << generic << " /" << setw(3) << compiled << " /" << setw(3) << swept;
+        }
+        cout << "\n";
+    }
+    setStencilPath(STENCIL_FIXED);
+
+    return check_status(failures);
+}
@@ -0,0 +1,348 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  suite_bench.cpp
+ *
+ *    Description:  End-to-end benchmark over synthetic clouds: each phase of building
+ *                  and using a graph, timed separately, across patterns, sizes, DEPTH
+ *                  and FOOT.  Results go to the console and optionally to CSV and JSON.
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:14:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "bench_util.h"
+#include "graph_traverse.h"
+#include "cloud_gen.h"
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define DIJKSTRA_QUERIES 4      // Sources per case, spread evenly over the vertices
+
+/*
+ * One row of results.  Each case runs in a child process, so that peak_rss_kb is the
+ * high-water mark of that case alone, and a case that runs out of memory does not take
+ * the rest of the sweep with it.
+ */
+struct CaseResult
+{
+    char pattern[16];
+    long points;
+    int depth, foot, threads;
+    bool ok;
+
+    long leaves, edges;
+    double save_ms, load_ms, load_mb_per_s,
+           encode_ms, sort_ms, build_ms, edges_ms, normals_ms,
+           adjacency_ms, dijkstra_ms;   // dijkstra_ms is per query
+    long peak_rss_kb;
+};
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void run_case(CaseResult&, const string&)
+ *  Description:  Run every phase of one case in this process, filling in result
+ * =====================================================================================
+ */
+void run_case(CaseResult &result, const string &scratch)
+{
+    FOOT = result.foot;
+    DIAM = 1 + 2 * FOOT;
+    NNEI = (int) pow(DIAM, NDIM);
+    NUM_THREADS = result.threads;
+
+    long num_points = result.points;
+    vector<double> points((size_t) NDIM * num_points);
+    generate_cloud(cloud_by_name(result.pattern), num_points, &points[0]);
+
+    /* Save and load as binary PLY */
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    if (!write_cloud_ply(scratch.c_str(), &points[0], num_points))
+        return;
+    result.save_ms = ms_since(start);
+
+    start = chrono::steady_clock::now();
+    PointReader reader;
+    vector<double> loaded((size_t) NDIM * num_points);
+    vector<float> normals((size_t) NDIM * num_points);
+    if (!reader.open(scratch.c_str()) || reader.read(num_points, &loaded[0], &normals[0]) != num_points)
+        return;
+    result.load_ms = ms_since(start);
+    result.load_mb_per_s = reader.bytes_read / 1e3 / max(result.load_ms, 1e-3);
+    unlink(scratch.c_str());
+    vector<double>().swap(loaded);
+    vector<float>().swap(normals);
+
+    /* Morton encoding */
+    start = chrono::steady_clock::now();
+    PointBuffer codes;
+    codes.reserve(num_points);
+    for (long i = 0; i < num_points; i++)
+    {
+        CodedPoint p(&points[NDIM * i], CLOUD_LIMITS, result.depth);
+        if (p.good_point)
+            codes.push_back(p);
+    }
+    result.encode_ms = ms_since(start);
+
+    start = chrono::steady_clock::now();
+    sortPoints(codes, result.depth);
+    result.sort_ms = ms_since(start);
+
+    /* Build */
+    start = chrono::steady_clock::now();
+    Octree tree(CLOUD_LIMITS, result.depth);
+    OctreeGraph graph;
+    tree.findPoints(codes.begin(), codes.end(), graph.getVertices(), true);
+    result.build_ms = ms_since(start);
+    result.leaves = graph.getNumVertices();
+    PointBuffer().swap(codes);
+
+    start = chrono::steady_clock::now();
+    graph.computeEdges();
+    result.edges_ms = ms_since(start);
+    result.edges = graph.getNumEdges();
+
+    start = chrono::steady_clock::now();
+    graph.computeNormals();
+    result.normals_ms = ms_since(start);
+
+    /* Shortest paths over the weighted CSR arrays */
+    start = chrono::steady_clock::now();
+    graph.buildAdjacency(point_distance);
+    result.adjacency_ms = ms_since(start);
+
+    PathWorkspace work;
+    start = chrono::steady_clock::now();
+    for (int q = 0; q < DIJKSTRA_QUERIES; q++)
+        dist_from(graph.getVertex((long) q * result.leaves / DIJKSTRA_QUERIES), graph, work, NULL);
+    result.dijkstra_ms = ms_since(start) / DIJKSTRA_QUERIES;
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_kb = usage.ru_maxrss;
+    result.ok = true;
+}
+
+/* Run the case in a child process and collect its row through a pipe */
+CaseResult fork_case(CaseResult result, const string &scratch)
+{
+    int channel[2];
+    if (pipe(channel) != 0)
+        return result;
+
+    cout.flush();
+    pid_t child = fork();
+    if (child == 0)
+    {
+        close(channel[0]);
+        QuietCout quiet;
+        run_case(result, scratch);
+        ssize_t written = write(channel[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+
+    close(channel[1]);
+    CaseResult received;
+    if (child > 0 && read(channel[0], &received, sizeof(received)) == sizeof(received))
+        result = received;
+    close(channel[0]);
+    if (child > 0)
+        waitpid(child, NULL, 0);
+    return result;
+}
+
+/* #####   Output   ################################################################# */
+
+const char *CSV_HEADER = "pattern,points,depth,foot,threads,ok,leaves,edges,save_ms,load_ms,"
+                         "load_mb_per_s,encode_ms,sort_ms,build_ms,edges_ms,normals_ms,"
+                         "adjacency_ms,dijkstra_ms,build_mpts_per_s,peak_rss_kb";
+
+// Points filed per second by encode, sort and build together, in millions
+double build_rate(const CaseResult &r)
+{
+    return r.points / 1e3 / max(r.encode_ms + r.sort_ms + r.build_ms, 1e-3);
+}
+
+void write_csv_row(ostream &out, const CaseResult &r)
+{
+    out << fixed << setprecision(3)
+        << r.pattern << "," << r.points << "," << r.depth << "," << r.foot << ","
+        << r.threads << "," << r.ok << "," << r.leaves << "," << r.edges << ","
+        << r.save_ms << "," << r.load_ms << "," << r.load_mb_per_s << ","
+        << r.encode_ms << "," << r.sort_ms << "," << r.build_ms << "," << r.edges_ms << ","
+        << r.normals_ms << "," << r.adjacency_ms << "," << r.dijkstra_ms << ","
+        << build_rate(r) << "," << r.peak_rss_kb << "\n";
+}
+
+void write_json(ostream &out, const vector<CaseResult> &results)
+{
+    istringstream header(CSV_HEADER);
+    vector<string> keys;
+    string key;
+    while (getline(header, key, ','))
+        keys.push_back(key);
+
+    out << "[";
+    for (unsigned int i = 0; i < results.size(); i++)
+    {
+        ostringstream row;
+        write_csv_row(row, results[i]);
+        istringstream values(row.str().substr(0, row.str().size() - 1));
+        string value;
+
+        out << (i == 0 ? "\n" : ",\n") << "  {";
+        for (unsigned int k = 0; k < keys.size() && getline(values, value, ','); k++)
+            out << (k == 0 ? "" : ", ") << "\"" << keys[k] << "\": "
+                << (k == 0 ? "\"" + value + "\"" : value);
+        out << "}";
+    }
+    out << "\n]\n";
+}
+
+/* #####   Arguments   ############################################################## */
+
+/* Comma-separated list; numbers may end in K or M */
+vector<string> split_list(const string &list)
+{
+    vector<string> items;
+    istringstream in(list);
+    string item;
+    while (getline(in, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+long parse_count(const string &item)
+{
+    long value = atol(item.c_str());
+    char suffix = item.empty() ? 0 : toupper(item[item.size() - 1]);
+    return value * (suffix == 'K' ? 1000 : suffix == 'M' ? 1000000 : 1);
+}
+
+void usage()
+{
+    cout << "usage: suite_bench [--patterns uniform,surface,clustered,scanline]\n"
+         << "                   [--points 10K,100K] [--depths 6,8] [--foots 1,2]\n"
+         << "                   [--threads N] [--sweep 0|1] [--csv FILE] [--json FILE]\n"
+         << "                   [--scratch FILE]\n";
+}
+
+int main(int argc, char **argv)
+{
+    vector<string> patterns(CLOUD_NAMES, CLOUD_NAMES + NUM_CLOUDS);
+    vector<string> sizes = split_list("10K,100K"), depths = split_list("6,8"),
+                   foots = split_list("1,2");
+    string csv_name, json_name, scratch = "suite_cloud.ply";
+    int threads = 1;
+
+    for (int a = 1; a < argc; a++)
+    {
+        string flag = argv[a];
+        if (a + 1 >= argc)
+        {
+            usage();
+            return -1;
+        }
+        string value = argv[++a];
+        if (flag == "--patterns")
+            patterns = split_list(value);
+        else if (flag == "--points")
+            sizes = split_list(value);
+        else if (flag == "--depths")
+            depths = split_list(value);
+        else if (flag == "--foots")
+            foots = split_list(value);
+        else if (flag == "--threads")
+            threads = max(1, atoi(value.c_str()));
+        else if (flag == "--sweep")
+            EDGE_SWEEP = atoi(value.c_str());
+        else if (flag == "--csv")
+            csv_name = value;
+        else if (flag == "--json")
+            json_name = value;
+        else if (flag == "--scratch")
+            scratch = value;
+        else
+        {
+            usage();
+            return -1;
+        }
+    }
+
+    for (unsigned int p = 0; p < patterns.size(); p++)
+        if (cloud_by_name(patterns[p]) == NUM_CLOUDS)
+        {
+            cout << "ERROR:  Unknown pattern " << patterns[p] << ".\n";
+            return -1;
+        }
+
+    cout << setw(10) << "pattern" << setw(10) << "points" << setw(6) << "depth"
+         << setw(5) << "foot" << setw(9) << "leaves" << setw(10) << "edges"
+         << setw(9) << "load" << setw(9) << "encode" << setw(9) << "sort"
+         << setw(9) << "build" << setw(9) << "edges" << setw(9) << "normals"
+         << setw(9) << "dijkstra" << setw(10) << "Mpts/s" << setw(10) << "RSS MB" << "\n";
+
+    vector<CaseResult> results;
+    int failures = 0;
+    for (unsigned int p = 0; p < patterns.size(); p++)
+        for (unsigned int s = 0; s < sizes.size(); s++)
+            for (unsigned int d = 0; d < depths.size(); d++)
+                for (unsigned int f = 0; f < foots.size(); f++)
+                {
+                    CaseResult r;
+                    memset(&r, 0, sizeof(r));
+                    strncpy(r.pattern, patterns[p].c_str(), sizeof(r.pattern) - 1);
+                    r.points = parse_count(sizes[s]);
+                    r.depth = atoi(depths[d].c_str());
+                    r.foot = atoi(foots[f].c_str());
+                    r.threads = threads;
+
+                    r = fork_case(r, scratch);
+                    results.push_back(r);
+
+                    cout << setw(10) << r.pattern << setw(10) << r.points << setw(6) << r.depth
+                         << setw(5) << r.foot;
+                    if (!r.ok)
+                    {
+                        cout << "   FAILED\n";
+                        failures++;
+                        continue;
+                    }
+                    cout << fixed << setprecision(1)
+                         << setw(9) << r.leaves << setw(10) << r.edges
+                         << setw(9) << r.load_ms << setw(9) << r.encode_ms
+                         << setw(9) << r.sort_ms << setw(9) << r.build_ms
+                         << setw(9) << r.edges_ms << setw(9) << r.normals_ms
+                         << setw(9) << r.dijkstra_ms << setw(10) << setprecision(2)
+                         << build_rate(r) << setw(10) << setprecision(1)
+                         << r.peak_rss_kb / 1024.0 << endl;
+                }
+    cout << "(times in ms; dijkstra is per query; Mpts/s is encode+sort+build)\n";
+
+    if (!csv_name.empty())
+    {
+        ofstream csv(csv_name.c_str());
+        csv << CSV_HEADER << "\n";
+        for (unsigned int i = 0; i < results.size(); i++)
+            write_csv_row(csv, results[i]);
+    }
+    if (!json_name.empty())
+    {
+        ofstream json(json_name.c_str());
+        write_json(json, results);
+    }
+
+    return check_status(failures);
+}
@@ -0,0 +1,169 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+ * =====================================================================================
+ *
+ *       Filename:  arena.h
+ *
+ *    Description:  Bump arena and typed slab pools for bulk-released tree storage
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 12:10:31 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include <vector>
+#include <new>
+#include <stdlib.h>
+#include <stddef.h>
+
+#define ARENA_BLOCK_BYTES (1 << 20)    // Raw arena block
+#define SLAB_BYTES (1 << 18)           // Target size of one slab of a typed pool
+
+/*
+ * =====================================================================================
+ *        Class:  Arena
+ *  Description:  Bump allocator for trivially destructible data.  Memory is handed out
+ *                  from large blocks and only ever returned all at once.
+ * =====================================================================================
+ */
+class Arena
+{
+    std::vector<char *> blocks;
+    size_t block_size,      // Size of a regular block
+           offset,          // First free byte in the last block
+           reserved,        // Total bytes obtained from malloc
+           used;            // Total bytes handed out
+
+    Arena(const Arena &);
+    Arena &operator=(const Arena &);
+
+public:
+    Arena(size_t new_block_size = ARENA_BLOCK_BYTES)
+    {
+        block_size = new_block_size;
+        offset = block_size;
+        reserved = 0;
+        used = 0;
+    }
+
+    ~Arena()
+    {
+        release();
+    }
+
+    void *allocate(size_t bytes, size_t alignment = sizeof(void *))
+    {
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        if (blocks.empty() || offset + bytes > block_size)
+        {
+            /* Oversized requests get a block to themselves */
+            size_t new_size = (bytes > block_size) ? bytes : block_size;
+            char *block = (char *) malloc(new_size);
+            if (block == NULL)
+                throw std::bad_alloc();
+            reserved += new_size;
+
+            if (bytes > block_size && !blocks.empty())
+            {
+                blocks.insert(blocks.end() - 1, block);
+                used += bytes;
+                return block;
+            }
+            blocks.push_back(block);
+            offset = 0;
+        }
+
+        void *result = blocks.back() + offset;
+        offset += bytes;
+        used += bytes;
+        return result;
+    }
+
+    /* Return every block at once */
+    void release()
+    {
+        for (size_t i = 0; i < blocks.size(); i++)
+            free(blocks[i]);
+        blocks.clear();
+        offset = block_size;
+        reserved = 0;
+        used = 0;
+    }
+
+    size_t bytesReserved() const { return reserved; }
+    size_t bytesUsed() const { return used; }
+};
+
+/*
+ * =====================================================================================
+ *        Class:  SlabPool
+ *  Description:  Typed pool that constructs objects in place in fixed-size slabs.
+ *                  Objects are never freed one at a time; clear() runs every destructor
+ *                  in allocation order and then returns the slabs.
+ * =====================================================================================
+ */
+template<typename T>
+class SlabPool
+{
+    std::vector<T *> slabs;
+    size_t slab_size,       // Objects per slab
+           count;           // Objects constructed so far
+
+    SlabPool(const SlabPool &);
+    SlabPool &operator=(const SlabPool &);
+
+public:
+    SlabPool()
+    {
+        slab_size = (SLAB_BYTES > sizeof(T)) ? SLAB_BYTES / sizeof(T) : 1;
+        count = 0;
+    }
+
+    ~SlabPool()
+    {
+        clear();
+    }
+
+    /*
+     * The slot is claimed before the constructor runs, so constructors may themselves
+     * create further objects in the same pool.
+     */
+    template<typename... Args>
+    T *create(Args &&... args)
+    {
+        if (count == slabs.size() * slab_size)
+        {
+            T *slab = (T *) malloc(slab_size * sizeof(T));
+            if (slab == NULL)
+                throw std::bad_alloc();
+            slabs.push_back(slab);
+        }
+
+        T *slot = &slabs[count / slab_size][count % slab_size];
+        count++;
+        return new (slot) T(static_cast<Args &&>(args)...);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < count; i++)
+            slabs[i / slab_size][i % slab_size].~T();
+        for (size_t i = 0; i < slabs.size(); i++)
+            free(slabs[i]);
+        slabs.clear();
+        count = 0;
+    }
+
+    size_t size() const { return count; }
+    size_t bytesReserved() const { return slabs.size() * slab_size * sizeof(T); }
+    size_t bytesUsed() const { return count * sizeof(T); }
+};
+
+#endif // ARENA_H
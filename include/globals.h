@@ -18,11 +18,17 @@ int DEPTH = 10;
 int FOOT = 2, DIAM, NNEI;
 double COVAR_SIGMA = 1;
 
+int NUM_THREADS = 1;
+int SPLIT_DEPTH = 3;
+int EDGE_SWEEP = 0;
+
 // #### VARIABLES FOR VISUALIZATION
 enum edge_enum {NONE, NORMALS, GRAPH};
 edge_enum edgetype = NONE;
 enum loc_enum {AVERAGE, NOMINAL};
 loc_enum loctype = AVERAGE;
+enum ply_enum {ASCII_PLY, BINARY_PLY};
+ply_enum plyformat = ASCII_PLY;
 
 
 // #### INITIALIZATION OF GLOBALS
@@ -44,11 +50,17 @@ void init_globals(){
 	init_arr("LIMS", LIMS, 6);
 	init_var("DEPTH", DEPTH);
 	init_vec("PLY_NAMES", PLY_NAMES);
+
+	init_var("NUM_THREADS", NUM_THREADS);
+	init_var("SPLIT_DEPTH", SPLIT_DEPTH);
+	init_var("EDGE_SWEEP", EDGE_SWEEP);
 }
 void init_viz(){
 	int temp = 0;
 	init_var("edgetype", temp); edgetype = (edge_enum) temp;
 	init_var("loctype", temp); loctype = (loc_enum) temp;
+	temp = plyformat;
+	init_var("plyformat", temp); plyformat = (ply_enum) temp;
 }
 
 
@@ -0,0 +1,90 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  graph_traverse.h
+ *
+ *    Description:  Shortest paths over an OctreeGraph
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:40:18 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef GRAPH_TRAVERSE_H
+#define GRAPH_TRAVERSE_H
+
+#include "octree.h"
+#include <limits>
+
+#define HEAP_ARITY 4    // Children per heap node; 4 keeps a node's children in one line
+
+/*
+ * =====================================================================================
+ *        Class:  IndexedHeap
+ *  Description:  d-ary min-heap of vertex indices keyed by distance, with a position
+ *                  table so a queued vertex can have its key lowered in place.  The
+ *                  table is sized once per graph; clear() only resets the entries that
+ *                  were used, so reusing the heap costs nothing per query.
+ * =====================================================================================
+ */
+class IndexedHeap
+{
+    vector<int> heap;           // Vertex indices in heap order
+    vector<double> keys;        // Keys parallel to heap
+    vector<int> position;       // Slot of each vertex in heap, or -1 if not queued
+
+public:
+    void resize(int num_vertices);
+    void clear();
+
+    bool empty() const { return heap.empty(); }
+    int size() const { return heap.size(); }
+    int top() const { return heap[0]; }
+    double topKey() const { return keys[0]; }
+    bool contains(int v) const { return position[v] >= 0; }
+
+    void pushOrDecrease(int v, double key);
+    int pop();
+
+private:
+    void siftUp(int slot);
+    void siftDown(int slot);
+    void place(int slot, int v, double key);
+};
+
+/*
+ * =====================================================================================
+ *        Class:  PathWorkspace
+ *  Description:  Buffers of a single-source shortest-path query, kept between queries.
+ *                  After dist_from, distances[i] is the distance to vertex i (infinity
+ *                  if it was not reached) and previous[i] its predecessor on the
+ *                  shortest path (i itself for the start and for unreached vertices).
+ * =====================================================================================
+ */
+struct PathWorkspace
+{
+    vector<double> distances;
+    vector<int> previous;
+    IndexedHeap heap;
+    vector<int> touched;        // Vertices whose entries differ from the defaults
+
+    long relaxations;           // Distance improvements in the last query
+    long settled;               // Vertices popped in the last query
+
+    void reset(int num_vertices);
+};
+
+void dist_from(OctreePoint *start, OctreeGraph &graph, PathWorkspace &work,
+               DistFunction df = point_distance,
+               double MAX_DIST = numeric_limits<double>::infinity());
+
+vector<double> dist_from(OctreePoint *start, OctreeGraph &graph, vector<int> &previous,
+                         DistFunction df = point_distance,
+                         double MAX_DIST = numeric_limits<double>::infinity());
+
+#endif // GRAPH_TRAVERSE_H
@@ -168,6 +168,130 @@ double gain(T1 mat[NDIM][NDIM], T2 v[NDIM]){
     return sqrt(total);
 }
 
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  jacobiLanes(double[6][LANES], double[9][LANES])
+ *  Description:  Diagonalizes LANES symmetric 3x3 matrices side by side with a fixed
+ *                  number of cyclic Jacobi sweeps.  a holds the upper triangles as
+ *                  (a00, a11, a22, a01, a02, a12); v receives the row-major eigenvector
+ *                  matrices, one eigenvector per column.  There are no data-dependent
+ *                  branches, so the lane loops vectorize.
+ * =====================================================================================
+ */
+#define JACOBI_SWEEPS 5
+#define EIG_LANES 8
+
+template <int LANES>
+void jacobiLanes(double a[6][LANES], double v[9][LANES]){
+    // Slots of (p,p), (q,q), (p,q), (r,p) and (r,q) for each rotation
+    static const int rot[3][5] = {
+        {0, 1, 3, 4, 5},        // (p,q) = (0,1), r = 2
+        {0, 2, 4, 3, 5},        // (p,q) = (0,2), r = 1
+        {1, 2, 5, 3, 4}};       // (p,q) = (1,2), r = 0
+    static const int vpq[3][2] = {{0, 1}, {0, 2}, {1, 2}};
+
+    for(int k=0; k<9; k++)
+        for(int l=0; l<LANES; l++)
+            v[k][l] = (k%4==0);
+
+    for(int sweep=0; sweep<JACOBI_SWEEPS; sweep++)
+        for(int r=0; r<3; r++){
+            double *app = a[rot[r][0]], *aqq = a[rot[r][1]], *apq = a[rot[r][2]],
+                   *arp = a[rot[r][3]], *arq = a[rot[r][4]];
+            int p = vpq[r][0], q = vpq[r][1];
+
+            for(int l=0; l<LANES; l++){
+                bool zero = (apq[l] == 0);
+                double theta = (aqq[l] - app[l]) / (zero ? 1 : 2*apq[l]);
+                double t = (theta >= 0 ? 1 : -1) / (fabs(theta) + sqrt(theta*theta + 1));
+                t = zero ? 0 : t;
+                double c = 1/sqrt(t*t + 1), s = t*c;
+
+                app[l] -= t*apq[l];
+                aqq[l] += t*apq[l];
+                apq[l] = 0;
+
+                double rp = arp[l], rq = arq[l];
+                arp[l] = c*rp - s*rq;
+                arq[l] = s*rp + c*rq;
+
+                for(int k=0; k<3; k++){
+                    double vkp = v[3*k+p][l], vkq = v[3*k+q][l];
+                    v[3*k+p][l] = c*vkp - s*vkq;
+                    v[3*k+q][l] = s*vkp + c*vkq;
+                }
+            }
+        }
+
+    // Sort eigenvalues ascending, carrying their columns along
+    static const int swaps[3][2] = {{0, 1}, {1, 2}, {0, 1}};
+    for(int k=0; k<3; k++){
+        int i = swaps[k][0], j = swaps[k][1];
+        for(int l=0; l<LANES; l++){
+            bool swap = a[j][l] < a[i][l];
+            double ai = a[i][l], aj = a[j][l];
+            a[i][l] = swap ? aj : ai;
+            a[j][l] = swap ? ai : aj;
+            for(int m=0; m<3; m++){
+                double vi = v[3*m+i][l], vj = v[3*m+j][l];
+                v[3*m+i][l] = swap ? vj : vi;
+                v[3*m+j][l] = swap ? vi : vj;
+            }
+        }
+    }
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  symmetricEigen(const T[NDIM][NDIM], double[NDIM], double[NDIM][NDIM])
+ *  Description:  All eigenvalues (ascending) and unit eigenvectors (evecs[k] belongs to
+ *                  evals[k]) of a symmetric 3x3 matrix
+ * =====================================================================================
+ */
+template <typename T>
+void symmetricEigen(const T A[NDIM][NDIM], double evals[NDIM], double evecs[NDIM][NDIM]){
+    double a[6][1] = {{A[0][0]}, {A[1][1]}, {A[2][2]}, {A[0][1]}, {A[0][2]}, {A[1][2]}};
+    double v[9][1];
+    jacobiLanes<1>(a, v);
+
+    for(int k=0; k<NDIM; k++){
+        evals[k] = a[k][0];
+        for(int m=0; m<NDIM; m++)
+            evecs[k][m] = v[3*m+k][0];
+    }
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  symmetricEigenBatch(int, const double[][NDIM][NDIM], double[][NDIM],
+ *                  double[][NDIM][NDIM])
+ *  Description:  symmetricEigen over n matrices, EIG_LANES at a time
+ * =====================================================================================
+ */
+inline void symmetricEigenBatch(int n, const double A[][NDIM][NDIM], double evals[][NDIM],
+                                double evecs[][NDIM][NDIM]){
+    static const int slot[6][2] = {{0, 0}, {1, 1}, {2, 2}, {0, 1}, {0, 2}, {1, 2}};
+
+    for(int begin=0; begin<n; begin+=EIG_LANES){
+        int lanes = (n - begin < EIG_LANES) ? n - begin : EIG_LANES;
+        double a[6][EIG_LANES], v[9][EIG_LANES];
+
+        // Pad short blocks with copies of the first matrix
+        for(int k=0; k<6; k++)
+            for(int l=0; l<EIG_LANES; l++)
+                a[k][l] = A[begin + ((l<lanes) ? l : 0)][slot[k][0]][slot[k][1]];
+
+        jacobiLanes<EIG_LANES>(a, v);
+
+        for(int l=0; l<lanes; l++)
+            for(int k=0; k<NDIM; k++){
+                evals[begin+l][k] = a[k][l];
+                for(int m=0; m<NDIM; m++)
+                    evecs[begin+l][k][m] = v[3*m+k][l];
+            }
+    }
+}
+
 template <typename T> 
 bool isZero(T* v, int numel){
     for(int i=0; i<numel; i++)
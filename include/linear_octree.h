@@ -0,0 +1,71 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  linear_octree.h
+ *
+ *    Description:  Pointerless octree stored as a sorted array of occupied leaf codes
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:02:16 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef LINEAR_OCTREE_H
+#define LINEAR_OCTREE_H
+
+#include "octree.h"
+
+/*
+ * =====================================================================================
+ *        Class:  LinearOctree
+ *  Description:  Leaves of an octree kept as one sorted array of codes, with the leaf
+ *                  attributes in parallel arrays.  Internal nodes are never stored: the
+ *                  ancestor of a leaf at depth d is the leaf's code with its low
+ *                  NDIM*(max_depth-d) bits cleared, and its descendants are the
+ *                  contiguous run of codes sharing that prefix.
+ *
+ *                  Leaf indices are positions in code order, so they are only stable
+ *                  until the next call to addPoints.
+ * =====================================================================================
+ */
+class LinearOctree
+{
+    vector<codestring> codes;   // Sorted codes of the occupied leaves
+    vector<double> locations;   // Averaged coordinates, NDIM per leaf
+    vector<float> normals;      // Averaged normals, NDIM per leaf
+    vector<int> num_points;     // Total number of points assigned to each leaf
+
+    double limits[2 * NDIM];    // Limits on the points in this volume
+
+public:
+    int max_depth;              // Depth of every leaf
+    LinearOctree(const double *new_limits, int new_max_depth);
+
+    void addPoints(const double *new_points, const float *new_normals, int num_points);
+
+    int findPoint(const double *location) const;
+    int findAddress(codestring address) const;
+    void findRange(codestring address, int depth, int &begin, int &end) const;
+    void findNeighbors(int leaf, vector<int> &neighbors) const;
+
+    // Accessor methods
+    int getNumLeaves() const;
+    codestring getAddress(int leaf) const;
+    const double *getLocation(int leaf) const;
+    const float *getNormal(int leaf) const;
+    int getNumPoints(int leaf) const;
+    const double *getLimits() const;
+
+    size_t memoryUsage() const;
+
+private:
+    void accumulate(int leaf, const PointIter begin, const PointIter end);
+    int searchCodes(codestring address, int begin, int end) const;
+};
+
+#endif // LINEAR_OCTREE_H
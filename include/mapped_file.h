@@ -0,0 +1,85 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+/*
+ * =====================================================================================
+ *
+ *       Filename:  mapped_file.h
+ *
+ *    Description:  Read-only memory maps of whole files
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:21:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * =====================================================================================
+ *        Class:  MappedFile
+ *  Description:  Read-only memory map of a whole file
+ * =====================================================================================
+ */
+struct MappedFile
+{
+    const char *data;
+    size_t size;
+
+    MappedFile() : data(NULL), size(0) {}
+    ~MappedFile() { close(); }
+
+    bool open(const char *filename)
+    {
+        close();
+        int fd = ::open(filename, O_RDONLY);
+        if (fd < 0)
+            return false;
+
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            void *map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                madvise(map, info.st_size, MADV_SEQUENTIAL);
+                data = (const char *) map;
+                size = info.st_size;
+            }
+        }
+        ::close(fd);
+        return data != NULL;
+    }
+
+    /* Let the kernel evict the pages before upto; they will not be read again */
+    void drop(const char *upto)
+    {
+        size_t page = sysconf(_SC_PAGESIZE),
+               length = (upto - data) / page * page;
+        if (data != NULL && length > 0)
+            madvise((void *) data, length, MADV_DONTNEED);
+    }
+
+    void close()
+    {
+        if (data != NULL)
+            munmap((void *) data, size);
+        data = NULL;
+        size = 0;
+    }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+#endif // MAPPED_FILE_H
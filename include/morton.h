@@ -0,0 +1,73 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  morton.h
+ *
+ *    Description:  Morton (Z-order) encoding and decoding of discretized locations
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:12:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef MORTON_H
+#define MORTON_H
+
+#include "octree.h"
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+#define MORTON_MAX_DEPTH 21     // NDIM*MORTON_MAX_DEPTH bits must fit in a codestring
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+/*
+ * Interchangeable implementations of the codec.  All of them are bit-exact with the
+ * original bit-by-bit loop (MORTON_LOOP), which is kept as the reference.
+ */
+enum morton_enum {MORTON_LOOP, MORTON_MAGIC, MORTON_TABLE, MORTON_BMI2};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+
+// Single-point codec, using the currently selected implementation
+codestring mortonEncode(const long *location, int max_depth);
+void mortonDecode(codestring code, long *location, int max_depth);
+
+// Batch codec: locations are packed NDIM to a point
+void mortonEncode(int n, const long *locations, codestring *codes, int max_depth);
+void mortonDecode(int n, const codestring *codes, long *locations, int max_depth);
+
+// The low MORTON_MAX_DEPTH bits of x, two zeros between each (x's axis-0 bits in a
+// code).  Slow, but usable in constant expressions.
+constexpr codestring mortonSpread(codestring x, int bit = 0)
+{
+    return (bit == MORTON_MAX_DEPTH) ? 0
+           : (((x >> bit) & 1) << (NDIM * bit)) | mortonSpread(x, bit + 1);
+}
+
+// Dilated-integer arithmetic on one axis of a code: the bits of axis j, and an offset
+// along it spread onto those bits (negative offsets in two's complement)
+codestring mortonAxisMask(int axis, int max_depth);
+codestring mortonStep(int axis, long offset, int max_depth);
+
+// Axis bits of code after adding a spread step, the carries hopping over the other
+// axes.  A step that leaves the volume wraps around, which the caller can detect by
+// comparing against code & mask, provided |offset| < 2^max_depth: a wider step can
+// wrap all the way round, onto the voxel itself or any other.
+inline codestring mortonAddAxis(codestring code, codestring step, codestring mask)
+{
+    return ((code | ~mask) + step) & mask;
+}
+
+// Implementation selection (chosen at startup: BMI2 when the CPU has it, else MAGIC)
+bool mortonHasBMI2();
+bool setMortonPath(morton_enum path);
+morton_enum getMortonPath();
+const char *mortonPathName(morton_enum path);
+
+#endif // MORTON_H
@@ -0,0 +1,78 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  occupancy.h
+ *
+ *    Description:  Compact occupancy-stream encoding of an octree and its leaves
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 06:20:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "octree.h"
+#include "morton.h"
+#include <iostream>
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+#define OCCUPANCY_MAGIC "OCTOCC"
+#define OCCUPANCY_VERSION 1
+#define OCCUPANCY_NORMALS 1         // Flag: the leaves carry normals (the only flag)
+#define OCCUPANCY_BLOCK 65536       // Leaves per block of attribute columns
+#define OFFSET_BITS 6               // Default bits per axis of a position within its voxel
+#define MAX_OFFSET_BITS 16
+#define NORMAL_STEPS 127            // Octahedral normal components are in [-127, 127]
+#define NORMAL_UNDEFINED -128       // Both components: the leaf had no normal
+
+/*
+ * Stream layout (all multi-byte values little-endian, counts as LEB128 varints):
+ *
+ *   header   magic[6], version, max_depth, flags (1: normals), offset bits,
+ *            limits[2*NDIM] as doubles, varint number of leaves
+ *   masks    one byte per internal node, breadth first, children in code order;
+ *            bit i set if octant i is occupied
+ *   leaves   in code order, in blocks of OCCUPANCY_BLOCK, each block holding
+ *              NDIM * offset bits per leaf, packed: position within the voxel, in
+ *                2^bits steps per axis
+ *              2 bytes per leaf: octahedral normal (if flagged)
+ *              point counts: varint run of leaves with one point, then the varint
+ *                count of the next leaf, and so on to the end of the block
+ */
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+/*
+ * Decoded leaves, in code order.  Locations and normals are the quantized values the
+ * stream holds, not the originals.
+ */
+struct OccupancyLeaves
+{
+    int max_depth;
+    double limits[2 * NDIM];
+    vector<unsigned char> masks;    // As in the stream: one per internal node, breadth first
+    vector<codestring> codes;
+    vector<double> locations;   // NDIM per leaf
+    vector<float> normals;      // NDIM per leaf (zero if the stream has none)
+    vector<int> num_points;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+
+void octahedralEncode(const float normal[NDIM], signed char code[2]);
+void octahedralDecode(const signed char code[2], float normal[NDIM]);
+
+bool writeOccupancy(ostream &out, Octree &tree, OctreeGraph &graph,
+                    int offset_bits = OFFSET_BITS);
+bool readOccupancy(istream &in, OccupancyLeaves &leaves);
+bool readOccupancy(istream &in, Octree &tree, OctreeGraph &graph);
+
+#endif // OCCUPANCY_H
@@ -37,6 +37,8 @@ using namespace std;
 #define PI 3.14159
 
 #include "linalg.h"
+#include "arena.h"
+#include "profile.h"
 
 /* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
 
@@ -49,6 +51,7 @@ template<typename T>
 void printBinary(T n, ostream &out);
 codestring locationToCode(const long *location, int max_depth);
 void codeToLocation(codestring code, long *location, int max_depth);
+void findLimits(const double *points, int num_points, double *limits);
 
 
 /* #####   EXPORTED CLASS DEFINITIONS   ############################################# */
@@ -57,6 +60,7 @@ class OctreePoint;
 class Octree;
 class OctreeEdge;
 class OctreeGraph;
+struct OctreeStorage;
 
 /*
  * =====================================================================================
@@ -73,9 +77,11 @@ class CodedPoint
 
     friend class Octree;
     friend class OctreePoint;
+    friend class LinearOctree;
 
     friend bool operator<(const CodedPoint &p1, const CodedPoint &p2);
     friend ostream &operator<<(ostream &out, const CodedPoint &p);
+    friend void sortPoints(vector<CodedPoint> &points, int max_depth);
 
 public:
     bool good_point;
@@ -93,6 +99,8 @@ public:
 #define ENOUGH_POINTS 20
 typedef vector<CodedPoint> PointBuffer;
 typedef PointBuffer::iterator PointIter;
+
+void sortPoints(PointBuffer &points, int max_depth);    // Stable radix sort by code
 /*
  * =====================================================================================
  *        Class:  OctreePoint
@@ -101,6 +109,7 @@ typedef PointBuffer::iterator PointIter;
  */
 typedef float (*DistFunction)(const OctreePoint*, const OctreePoint*);
 float point_distance(const OctreePoint *p1, const OctreePoint *p2);
+bool index_less(const OctreePoint *p1, const OctreePoint *p2);  // Order by vertex index
 class OctreePoint
 {
     Octree *home;
@@ -149,11 +158,18 @@ public:
     const float *getNormal() const;
 
     int getDepth() const;
+    int getNumPoints() const;
 
 private:
-    void findNeighbors(OctreeGraph &graph);
+    void findNeighbors();
     void computeCovariance(double cov[NDIM][NDIM], double sigma);
+    void computeCovariance(const vector<OctreePoint*> &neighbors, double cov[NDIM][NDIM],
+                           double sigma);
+    template <int F>
+    void covarianceKernel(const vector<OctreePoint*> &neighbors, double cov[NDIM][NDIM],
+                          double sigma);
     void computeNormal();
+    void setNormal(const double evals[NDIM], const double evecs[NDIM][NDIM]);
 };
 
 template <typename t> int sgn(t val)
@@ -179,6 +195,27 @@ public:
     OctreeEdge(OctreePoint *new_p1, OctreePoint *new_p2);
 };
 
+/*
+ * =====================================================================================
+ *        Class:  Span
+ *  Description:  Non-owning view of a contiguous run of elements
+ * =====================================================================================
+ */
+template<typename T>
+struct Span
+{
+    T *first;
+    int count;
+
+    Span(T *new_first = NULL, int new_count = 0) : first(new_first), count(new_count) {}
+
+    T *begin() const { return first; }
+    T *end() const { return first + count; }
+    int size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](int i) const { return first[i]; }
+};
+
 /*
  * =====================================================================================
  *        Class:  OctreeGraph
@@ -191,18 +228,40 @@ class OctreeGraph
     vector<OctreeEdge *> edges;      // Storage for OctreeEdges
     vector<int> frame_indices;
 
+    bool use_arena;                  // Allocate edges from edge_pool rather than new
+    SlabPool<OctreeEdge> edge_pool;  // Owns the edges when use_arena is set
+
+    /* Compressed sparse row adjacency: the neighbors of vertex i are
+     * adj_indices[adj_offsets[i] .. adj_offsets[i+1]), in ascending order */
+    vector<long> adj_offsets;        // num_vertices+1 row starts (empty until built)
+    vector<int> adj_indices;         // Neighbor vertex indices
+    vector<float> adj_weights;       // Per-entry weights, parallel to adj_indices (optional)
+    bool edges_released;             // Pointer lists were dropped by releasePointerEdges
+
+    /* Dense stencil layout: slots[NNEI*i + s] is the index of the vertex at stencil
+     * offset s (stencilSlot) from vertex i, or -1.  Kept with the edges if use_slots */
+    bool use_slots;
+    vector<int> slots;
+
     friend ostream &operator<<(ostream &out, OctreeGraph &graph);
 
 public:
-    OctreeGraph();
+    OctreeGraph(bool new_use_arena = true, bool new_use_slots = false);
+    ~OctreeGraph();
 
     void addPoint(OctreePoint *p);
     void addEdge(OctreePoint *p1, OctreePoint *p2);
 
     void computeEdges();
+    void updateEdges(int first_new);
     void computeNormals();
+    void computeNormals(Octree &tree, double radius);
     void reserve(int new_capacity);
 
+    void buildAdjacency(DistFunction weight = NULL);
+    void releasePointerEdges();
+    void clearAdjacency();
+
     vector<OctreePoint *> &getVertices();
     vector<OctreeEdge *> &getEdges();
     OctreePoint *getVertex(int i);
@@ -210,7 +269,28 @@ public:
     int getNumVertices() const;
     int getNumEdges() const;
 
+    // CSR accessors, valid from buildAdjacency until the edges next change
+    bool hasAdjacency() const;
+    bool hasWeights() const;
+    int getDegree(int i) const;
+    Span<const int> getAdjacent(int i) const;
+    Span<const float> getWeights(int i) const;
+    long getNumAdjacent() const;
+
+    // Stencil slot accessors, valid while the edges are (with use_slots)
+    bool hasSlots() const;
+    Span<const int> getSlots(int i) const;
+    int getNeighborIndex(int i, const int relative_coords[NDIM]) const;
+    OctreePoint *getNeighbor(int i, const int relative_coords[NDIM]);
+
+    size_t bytesReserved() const;
+    size_t bytesUsed() const;
+
 private:
+    void clearEdges();
+    void searchNeighbors(int first);
+    void sweepNeighbors();
+    void fillSlots(int i);
     void fixNormals(OctreePoint *start, vector<float> &total_turn);
 };
 
@@ -242,6 +322,8 @@ class Octree
 
     double limits[2 * NDIM];     // Limits on the points in this volume;
 
+    OctreeStorage *storage;     // Pools shared by the whole tree (NULL: heap)
+
     friend class OctreePoint;
     friend class OctreeGraph;
 
@@ -249,7 +331,7 @@ class Octree
 
 public:
     int max_depth;              // Max depth allowable in this tree
-    Octree(const double *new_limits, int new_max_depth);
+    Octree(const double *new_limits, int new_max_depth, bool use_arena = true);
     Octree(const double *temp_limits, const float *resolutions, int new_max_depth,
            int voxel_type);
     Octree(const PointIter new_begin, const PointIter new_end, Octree *new_parent,
@@ -258,6 +340,14 @@ public:
 
     void addPoints(const double *new_points, const float *new_normals,
                    int num_points, OctreeGraph &graph);
+    int insertPoints(const double *new_points, const float *new_normals,
+                     int num_points, OctreeGraph &graph);
+    int insertLeaves(const codestring *codes, const double *locations,
+                     const float *normals, const int *num_points, int num_leaves,
+                     OctreeGraph &graph);
+    int insertMasks(const unsigned char *masks, long num_masks, const double *locations,
+                    const float *normals, const int *num_points, int num_leaves,
+                    OctreeGraph &graph);
     void findPoints(PointIter new_begin, const PointIter new_end,
                     vector<OctreePoint *> &new_points, bool adding);
     Octree* searchUp(codestring minCode, codestring maxCode);
@@ -266,8 +356,76 @@ public:
 
     OctreePoint *findPoint(const double *location);
 
+    // Nearest leaves by Euclidean distance to their averaged locations
+    int knn(const double *query, int k, vector<OctreePoint *> &out,
+            vector<double> *distances = NULL);
+    void knnBatch(const double *queries, int num_queries, int k,
+                  vector<OctreePoint *> &out, vector<double> *distances = NULL);
+
+    // Leaves whose averaged locations lie within a metric radius
+    int radiusSearch(const double *center, double radius, vector<OctreePoint *> &out,
+                     vector<double> *distances = NULL);
+    void radiusSearchBatch(const double *centers, int num_queries, double radius,
+                           vector<long> &offsets, vector<OctreePoint *> &out);
+
+    void setLimits(const double *new_limits);
+    const double *getLimits() const;
+
+    size_t bytesReserved() const;
+    size_t bytesUsed() const;
+
 private:
+    struct BuildTask;
+    struct BuildSpan;
+    struct SearchWorkspace;
+
     OctreePoint *findAddress(codestring query_address);
+    void fileSorted(vector<CodedPoint> &new_codes, OctreeGraph &graph);
+    void fileChild(int i, PointIter begin, const PointIter end,
+                   vector<OctreePoint*>& new_points, bool adding);
+    void findCodes(const codestring *begin, const codestring *end,
+                   vector<OctreePoint*>& found);
+    void findPointsParallel(PointIter begin, const PointIter end,
+                            vector<OctreePoint*>& new_points, int num_threads,
+                            int split_depth);
+    void collectTasks(PointIter begin, const PointIter end, int split_depth,
+                      vector<BuildTask>& tasks, vector<BuildSpan>& upper);
+    Octree *newChild(const PointIter new_begin, const PointIter new_end,
+                     codestring new_address, vector<OctreePoint*>& new_points);
+    OctreePoint *newLeaf(const PointIter new_begin, const PointIter new_end);
+    void knnSearch(const double *query, int k, double bound, SearchWorkspace &work);
+    void radiusCollect(const double *center, double radius2, vector<OctreePoint *> &out,
+                       vector<double> *distances2, SearchWorkspace &work);
+};
+
+/*
+ * =====================================================================================
+ *       Struct:  OctreeStorage
+ *  Description:  Pools owning every node, child array and leaf of an arena-built tree.
+ *                  Deleting the root releases them all in one pass.  Each thread of a
+ *                  parallel build allocates from its own shard, so the pools need no
+ *                  locking.
+ * =====================================================================================
+ */
+struct OctreePools
+{
+    SlabPool<Octree> nodes;
+    SlabPool<OctreePoint> leaves;
+    Arena child_arrays;
+};
+
+struct OctreeStorage
+{
+    vector<OctreePools *> shards;   // One per thread-pool participant
+
+    OctreeStorage();
+    ~OctreeStorage();
+
+    OctreePools &local();           // Shard of the calling thread
+    void reserveShards(int num_shards);
+
+    size_t bytesReserved() const;
+    size_t bytesUsed() const;
 };
 
 /*
@@ -289,16 +447,6 @@ struct basic_nullbuf : std::basic_streambuf<Ch, Traits>
     }
 };
 
-// macro for timing
-#define TIC(MESSAGE) {                  \
-cout << MESSAGE;                        \
-cout.flush();                           \
-clock_t TIC_TIME = clock();
-
-#define TOC                                                                                         \
-cout << "DONE";                                                                                     \
-cout << " (" << (int)((clock() - TIC_TIME) * (((double) 1000) / CLOCKS_PER_SEC)) << "ms).\n"; }
-
 template<typename T>
 T ternary(bool test, T t1, T t2){
     if(test) return t1;
@@ -319,5 +467,8 @@ extern int FOOT; /* Radius of footprint */
 extern int DIAM;
 extern int NNEI;
 extern double COVAR_SIGMA;
+extern int NUM_THREADS; /* Worker threads for parallel phases (1 = serial) */
+extern int SPLIT_DEPTH; /* Depth at which a parallel build splits into tasks */
+extern int EDGE_SWEEP; /* computeEdges by one sorted join over all leaves (1) or per vertex (0) */
 
 #endif
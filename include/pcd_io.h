@@ -2,11 +2,14 @@
 #define PCD_IO_H
 
 #include "octree.h"
+#include "thread_pool.h"
 #include <fstream>
 #include <string>
 #include <sstream>
 #include <time.h>
 #include <string.h>
+#include <stdlib.h>
+#include "mapped_file.h"
 using namespace std;
 
 bool load_coords(ifstream &f, int num_fields, const int *field_map, double *points, float *normals)
@@ -41,15 +44,375 @@ bool read_points(ifstream &f, int num_pts, int num_fields, const int *field_map,
     return good;
 }
 
+/* Powers of ten that are exact in a double */
+const double EXACT_POW10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool parse_double(const char*&, const char*, double&)
+ *  Description:  Parse the number starting at p (after any blanks) and leave p just
+ *                  past it.  A mantissa of at most 2^53 scaled by at most 10^22 takes a
+ *                  single correctly rounded multiply or divide, so the result equals
+ *                  strtod's; anything else (long mantissas, large exponents, nan, inf)
+ *                  is handed to strtod.  Never reads at or past end.
+ * =====================================================================================
+ */
+bool parse_double(const char *&p, const char *end, double &value)
+{
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    const char *start = p;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = (*p++ == '-');
+
+    unsigned long long mantissa = 0;
+    int num_digits = 0, exponent = 0;
+    bool any_digits = false, exact = true;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        any_digits = true;
+        if (num_digits < 19)
+        {
+            mantissa = 10 * mantissa + (*p - '0');
+            num_digits += (mantissa != 0);
+        }
+        else
+        {
+            exact = exact && (*p == '0');
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.')
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            any_digits = true;
+            if (num_digits < 19)
+            {
+                mantissa = 10 * mantissa + (*p - '0');
+                num_digits += (mantissa != 0);
+                exponent--;
+            }
+            else
+                exact = exact && (*p == '0');
+        }
+
+    if (any_digits && p < end && (*p == 'e' || *p == 'E'))
+    {
+        const char *mark = p++;
+        bool negative_exp = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative_exp = (*p++ == '-');
+
+        int exp_value = 0;
+        bool exp_digits = false;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            exp_digits = true;
+            if (exp_value < 100000)
+                exp_value = 10 * exp_value + (*p - '0');
+        }
+
+        if (exp_digits)
+            exponent += negative_exp ? -exp_value : exp_value;
+        else
+            p = mark;   // "1e" is the number 1 followed by junk, as for strtod
+    }
+
+    if (any_digits && exact && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22)
+    {
+        value = (double) mantissa;
+        if (exponent < 0)
+            value /= EXACT_POW10[-exponent];
+        else
+            value *= EXACT_POW10[exponent];
+        if (negative)
+            value = -value;
+        return true;
+    }
+
+    /* Slow path: strtod on a terminated copy of the token */
+    const char *token_end = start;
+    while (token_end < end && *token_end != ' ' && *token_end != '\t'
+           && *token_end != '\r' && *token_end != '\n')
+        token_end++;
+
+    string token(start, token_end);
+    char *stop;
+    value = strtod(token.c_str(), &stop);
+    p = start + (stop - token.c_str());
+    return stop != token.c_str();
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool parse_coords(const char*&, const char*, int, const int*, double*,
+ *                                  float*)
+ *  Description:  In-place counterpart of load_coords: parse one line of num_fields
+ *                  values, storing them through field_map, and leave p at the start of
+ *                  the next line.
+ * =====================================================================================
+ */
+bool parse_coords(const char *&p, const char *end, int num_fields, const int *field_map, double *points, float *normals)
+{
+    double value;
+    for (int i = 0; i < num_fields; i++)
+    {
+        if (!parse_double(p, end, value))
+            return false;
+        if (field_map[i] >= 0 && field_map[i] < NDIM)
+            points[field_map[i]] = value;
+        else if (field_map[i] >= NDIM && field_map[i] < 2 * NDIM)
+            normals[field_map[i] - NDIM] = value;
+    }
+
+    const char *newline = (const char *) memchr(p, '\n', end - p);
+    p = (newline != NULL) ? newline + 1 : end;
+    return true;
+}
+
+bool read_points_mapped(const char *&p, const char *end, int num_pts, int num_fields, const int *field_map, double *points, float *normals)
+{
+    bool good = true;
+    for (int i = 0; i < num_pts && good; i++)
+        good = parse_coords(p, end, num_fields, field_map, &points[NDIM * i], &normals[NDIM * i]);
+    return good;
+}
+
+#define PARSE_CHUNK_BYTES (1 << 20)  // Smallest byte range worth a parsing task
+
+/* Number of lines starting in [begin, end), counting an unterminated last one */
+long count_lines(const char *begin, const char *end)
+{
+    long num_lines = 0;
+    const char *p = begin;
+    while (p < end)
+    {
+        const char *newline = (const char *) memchr(p, '\n', end - p);
+        num_lines++;
+        if (newline == NULL)
+            break;
+        p = newline + 1;
+    }
+    return num_lines;
+}
+
+#define PARSE_SAMPLE_LINES 256       // Lines measured to size the first window
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  long parse_lines_chunked(const char*&, const char*, long, int,
+ *                                         const int*, double*, float*, int)
+ *  Description:  Parse the first num_pts lines of [p, end), or all of them if there are
+ *                  fewer, on num_threads threads; end must fall just past a newline or
+ *                  at the end of the body.  The range is cut into byte ranges that each
+ *                  begin at the start of a line; a first parallel pass counts the lines
+ *                  of every range, and the prefix sums of the counts give the index of
+ *                  the first point of each range, so the ranges can then be parsed at
+ *                  once straight into their slots.  Returns the number of points parsed
+ *                  and leaves p after the last of them, or returns -1 if a line failed.
+ * =====================================================================================
+ */
+long parse_lines_chunked(const char *&p, const char *end, long num_pts, int num_fields, const int *field_map, double *points, float *normals, int num_threads)
+{
+    long num_chunks = max(1l, min((long) (end - p) / PARSE_CHUNK_BYTES, 4l * num_threads));
+
+    // Chunk boundaries, each moved forward to just past a newline
+    vector<const char *> bounds(num_chunks + 1);
+    bounds[0] = p;
+    bounds[num_chunks] = end;
+    for (long c = 1; c < num_chunks; c++)
+    {
+        const char *guess = p + (end - p) * c / num_chunks;
+        const char *newline = (guess < end) ? (const char *) memchr(guess, '\n', end - guess) : NULL;
+        bounds[c] = max(bounds[c - 1], (newline != NULL) ? newline + 1 : end);
+    }
+
+    ThreadPool &pool = getThreadPool(num_threads);
+    vector<long> first_line(num_chunks + 1, 0);
+    pool.run(num_chunks, [&](int c)
+    {
+        first_line[c + 1] = count_lines(bounds[c], bounds[c + 1]);
+    });
+    for (long c = 0; c < num_chunks; c++)
+        first_line[c + 1] += first_line[c];
+
+    vector<char> good(num_chunks, true);
+    vector<const char *> stops(num_chunks, (const char *) NULL);
+    pool.run(num_chunks, [&](int c)
+    {
+        if (first_line[c] >= num_pts)
+            return;
+        long count = min(first_line[c + 1], num_pts) - first_line[c];
+        const char *q = bounds[c];
+        for (long i = first_line[c]; i < first_line[c] + count && good[c]; i++)
+            good[c] = parse_coords(q, bounds[c + 1], num_fields, field_map, &points[NDIM * i], &normals[NDIM * i]);
+        stops[c] = q;
+    });
+
+    for (long c = 0; c < num_chunks; c++)
+        if (first_line[c] < num_pts)
+        {
+            if (!good[c])
+                return -1;
+            p = stops[c];
+        }
+    return min(first_line[num_chunks], num_pts);
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool read_points_chunked(const char*&, const char*, int, int,
+ *                                         const int*, double*, float*, int)
+ *  Description:  read_points_mapped on num_threads threads.  The points are parsed by
+ *                  parse_lines_chunked in windows sized to hold the lines still to be
+ *                  read, from the bytes per line seen so far, so a block of a large body
+ *                  only scans (and faults in) about its own bytes.  Lines past the last
+ *                  point (such as further PLY elements) are never parsed.  Should any
+ *                  line fail to parse, the whole range is read again sequentially, so
+ *                  the arrays always match read_points_mapped.
+ * =====================================================================================
+ */
+bool read_points_chunked(const char *&p, const char *end, int num_pts, int num_fields, const int *field_map, double *points, float *normals, int num_threads)
+{
+    if (num_threads <= 1 || end - p < 2 * PARSE_CHUNK_BYTES)
+        return read_points_mapped(p, end, num_pts, num_fields, field_map, points, normals);
+
+    // Bytes per line, from the first few lines
+    const char *start = p, *sample_end = p;
+    long num_sampled = 0;
+    while (num_sampled < min((long) num_pts, (long) PARSE_SAMPLE_LINES) && sample_end < end)
+    {
+        const char *newline = (const char *) memchr(sample_end, '\n', end - sample_end);
+        sample_end = (newline != NULL) ? newline + 1 : end;
+        num_sampled++;
+    }
+
+    long done = 0;
+    while (done < num_pts && p < end)
+    {
+        double bytes_per_line = (done > 0) ? (p - start) / (double) done
+                                           : (sample_end - start) / (double) max(num_sampled, 1l);
+        double window = bytes_per_line * (num_pts - done) * 1.05 + PARSE_CHUNK_BYTES / 16;
+
+        // The window ends just past a newline, so that no line is cut
+        const char *limit = end;
+        if (window < end - p)
+        {
+            const char *newline = (const char *) memchr(p + (long) window - 1, '\n', end - p - (long) window + 1);
+            limit = (newline != NULL) ? newline + 1 : end;
+        }
+
+        long parsed = parse_lines_chunked(p, limit, num_pts - done, num_fields, field_map, &points[NDIM * done], &normals[NDIM * done], num_threads);
+        if (parsed <= 0)
+            break;
+        done += parsed;
+    }
+
+    if (done < num_pts)
+    {
+        p = start;
+        fill(points, points + (size_t) NDIM * num_pts, 0.0);
+        fill(normals, normals + (size_t) NDIM * num_pts, 0.0f);
+        return read_points_mapped(p, end, num_pts, num_fields, field_map, points, normals);
+    }
+    return true;
+}
+
+#define MAX_FIELDS 64   // Most per-point fields a header may declare
+
+enum format_enum {FORMAT_ASCII, FORMAT_BINARY_LE, FORMAT_BINARY_BE, FORMAT_UNSUPPORTED};
+enum field_type_enum {FIELD_INT8, FIELD_UINT8, FIELD_INT16, FIELD_UINT16,
+                      FIELD_INT32, FIELD_UINT32, FIELD_FLOAT32, FIELD_FLOAT64, FIELD_UNKNOWN};
+
+/*
+ * =====================================================================================
+ *        Class:  FieldLayout
+ *  Description:  Encoding of the point records, as declared by the header.  For binary
+ *                  bodies each record is stride bytes and field i starts offsets[i]
+ *                  bytes into it.
+ * =====================================================================================
+ */
+struct FieldLayout
+{
+    format_enum format;
+    field_type_enum types[MAX_FIELDS];
+    int offsets[MAX_FIELDS];
+    int stride;                 // Bytes per record, or -1 if records vary in size
+};
+
+const int FIELD_SIZES[] = {1, 1, 2, 2, 4, 4, 4, 8, 0};
+
+/* Type of a PLY property ("float", "float32", "uchar", ...) */
+field_type_enum ply_field_type(const string &name)
+{
+    const char *names[][2] = {{"char", "int8"}, {"uchar", "uint8"}, {"short", "int16"},
+                              {"ushort", "uint16"}, {"int", "int32"}, {"uint", "uint32"},
+                              {"float", "float32"}, {"double", "float64"}};
+    for (int i = 0; i < FIELD_UNKNOWN; i++)
+        if (name == names[i][0] || name == names[i][1])
+            return (field_type_enum) i;
+    return FIELD_UNKNOWN;
+}
+
+/* Type of a PCD field from its TYPE letter and SIZE */
+field_type_enum pcd_field_type(char type, int size)
+{
+    for (int i = 0; i < FIELD_UNKNOWN; i++)
+    {
+        bool is_float = (i >= FIELD_FLOAT32), is_signed = is_float || (i % 2 == 0);
+        if (FIELD_SIZES[i] == size
+            && ((type == 'F' && is_float) || (type == 'I' && !is_float && is_signed)
+                || (type == 'U' && !is_float && !is_signed)))
+            return (field_type_enum) i;
+    }
+    return FIELD_UNKNOWN;
+}
+
+/* Lay the fields out back to back; an unknown type makes the records unreadable */
+void finish_layout(FieldLayout &layout, int num_fields)
+{
+    layout.stride = 0;
+    for (int i = 0; i < num_fields; i++)
+    {
+        layout.offsets[i] = layout.stride;
+        if (layout.types[i] == FIELD_UNKNOWN)
+        {
+            layout.stride = -1;
+            return;
+        }
+        layout.stride += FIELD_SIZES[layout.types[i]];
+    }
+}
+
+/* Index in FIELD_NAMES of a field name, or -1 */
 const char FIELD_NAMES[6][10] = {"x", "y", "z", "nx", "ny", "nz"};
-bool read_pcd_header(ifstream &f, int &num_pts, int &num_fields, int *field_map, bool &haveNormals)
+const char PCL_FIELD_NAMES[6][10] = {"x", "y", "z", "normal_x", "normal_y", "normal_z"};
+int field_index(const string &name)
+{
+    for (int i = 0; i < 2 * NDIM; i++)
+        if (name == FIELD_NAMES[i] || name == PCL_FIELD_NAMES[i])
+            return i;
+    return -1;
+}
+
+bool read_pcd_header(ifstream &f, int &num_pts, int &num_fields, int *field_map, bool &haveNormals, FieldLayout &layout)
 {
     int position=-1;
     string line, heading;
     bool inHeader = true;
     double numtest;
 
+    // Declared fields, before COUNT expands them into columns
+    vector<int> names;
+    vector<int> sizes, counts;
+    vector<char> types;
+
     haveNormals = false;
+    layout.format = FORMAT_ASCII;
     while (inHeader && f.good())
     {
         position = f.tellg();
@@ -61,23 +424,29 @@ bool read_pcd_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
         // Get number of fields
         if (heading.compare("FIELDS") == 0)
         {
-            char fieldname[10];
-            int fieldnum = 0;
+            string fieldname;
+            names.clear();
             while (lss >> fieldname)
-            {
-                field_map[fieldnum] = -1; // unused
-                for (int i = 0; i < 2 * NDIM; i++)
-                {
-                    if (strcmp(fieldname, FIELD_NAMES[i]) == 0)
-                    {
-                        field_map[fieldnum] = i;
-                        if (i >= NDIM)
-                            haveNormals = true;
-                    }
-                }
-                fieldnum++;
-            }
-            num_fields = fieldnum;
+                names.push_back(field_index(fieldname));
+            continue;
+        }
+
+        // Get field encodings
+        if (heading.compare("SIZE") == 0 || heading.compare("COUNT") == 0)
+        {
+            vector<int> &values = (heading[0] == 'S') ? sizes : counts;
+            int value;
+            values.clear();
+            while (lss >> value)
+                values.push_back(value);
+            continue;
+        }
+        if (heading.compare("TYPE") == 0)
+        {
+            char type;
+            types.clear();
+            while (lss >> type)
+                types.push_back(type);
             continue;
         }
 
@@ -88,6 +457,22 @@ bool read_pcd_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
             continue;
         }
 
+        // A binary body starts right after the DATA line
+        if (heading.compare("DATA") == 0)
+        {
+            string format;
+            lss >> format;
+            if (format.compare("binary") == 0)
+            {
+                layout.format = FORMAT_BINARY_LE;   // PCD binary is little-endian
+                position = f.tellg();
+                break;
+            }
+            if (format.compare("ascii") != 0)
+                layout.format = FORMAT_UNSUPPORTED;
+            continue;
+        }
+
         // Check for end of header
         istringstream hss(heading);
         if (hss >> numtest)
@@ -97,21 +482,40 @@ bool read_pcd_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
         }
     }
 
+    // Expand fields with COUNT > 1 into one column per value
+    num_fields = 0;
+    for (unsigned int i = 0; i < names.size(); i++)
+    {
+        int count = (i < counts.size()) ? counts[i] : 1;
+        field_type_enum type = pcd_field_type((i < types.size()) ? types[i] : 'F',
+                                              (i < sizes.size()) ? sizes[i] : 4);
+        for (int k = 0; k < count && num_fields < MAX_FIELDS; k++, num_fields++)
+        {
+            field_map[num_fields] = (count == 1) ? names[i] : -1;
+            layout.types[num_fields] = type;
+        }
+        if (count == 1 && names[i] >= NDIM)
+            haveNormals = true;
+    }
+    finish_layout(layout, num_fields);
+
+    f.clear();
     f.seekg(position);
     return f.good();
 }
 
 
-bool read_ply_header(ifstream &f, int &num_pts, int &num_fields, int *field_map, bool &haveNormals)
+bool read_ply_header(ifstream &f, int &num_pts, int &num_fields, int *field_map, bool &haveNormals, FieldLayout &layout)
 {
     string line, heading, type;
-    bool inHeader = true, inVertex = false;
-    for (int i = 0; i < 6; i++)
+    bool inHeader = true, inVertex = false, seenVertex = false, vertexFirst = true;
+    for (int i = 0; i < MAX_FIELDS; i++)
         field_map[i] = -1;
 
     int fieldnum = 0;
 
     haveNormals = false;
+    layout.format = FORMAT_ASCII;
     while (inHeader && f.good())
     {
         getline(f, line);
@@ -119,6 +523,19 @@ bool read_ply_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
         istringstream lss(line);
         lss >> heading;
 
+        // Get body encoding
+        if (heading.compare("format") == 0)
+        {
+            lss >> type;
+            if (type.compare("binary_little_endian") == 0)
+                layout.format = FORMAT_BINARY_LE;
+            else if (type.compare("binary_big_endian") == 0)
+                layout.format = FORMAT_BINARY_BE;
+            else if (type.compare("ascii") != 0)
+                layout.format = FORMAT_UNSUPPORTED;
+            continue;
+        }
+
         // Get number of vertices
         if (heading.compare("element") == 0)
         {
@@ -126,28 +543,32 @@ bool read_ply_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
             if (type.compare("vertex") == 0)
             {
                 inVertex = true;
+                seenVertex = true;
                 lss >> num_pts;
             }
-            else inVertex = false;
+            else
+            {
+                inVertex = false;
+                vertexFirst = vertexFirst && seenVertex;
+            }
             continue;
         }
 
         // Get number of fields
-        if ((heading.compare("property") == 0) && inVertex)
+        if ((heading.compare("property") == 0) && inVertex && fieldnum < MAX_FIELDS)
         {
-            char fieldname[10];
+            string fieldname;
             lss >> type;
+            if (type.compare("list") == 0)
+                layout.types[fieldnum] = FIELD_UNKNOWN;  // variable-length records
+            else
+                layout.types[fieldnum] = ply_field_type(type);
+
             if (lss >> fieldname)
             {
-                for (int i = 0; i < 6; i++)
-                {
-                    if (strcmp(fieldname, FIELD_NAMES[i]) == 0)
-                    {
-                        field_map[fieldnum] = i;
-                        if (i >= 3)
-                            haveNormals = true;
-                    }
-                }
+                field_map[fieldnum] = field_index(fieldname);
+                if (field_map[fieldnum] >= NDIM)
+                    haveNormals = true;
                 fieldnum++;
             }
             num_fields = fieldnum;
@@ -161,54 +582,270 @@ bool read_ply_header(ifstream &f, int &num_pts, int &num_fields, int *field_map,
             break;
         }
     }
+
+    finish_layout(layout, num_fields);
+    // A binary body can only be read in place if the vertices come first
+    if (!vertexFirst && layout.format != FORMAT_ASCII)
+        layout.format = FORMAT_UNSUPPORTED;
     return f.good();
 }
 
 
-bool load_points_from_pxx(const char *filename, Octree &tree, OctreeGraph &graph)
+/* One value of the given type at p, converted to double; swap reverses its bytes */
+template<typename T>
+double load_value(const char *p, bool swap)
 {
-    int num_points, num_fields = 0, field_map[6];
-    double *points;
-    float *normals;
-    bool haveNormals = false, result = false;
+    T value;
+    if (!swap)
+    {
+        memcpy(&value, p, sizeof(T));
+        return value;
+    }
 
-    cout << "\nOpening file " << filename << ".\n";
-    ifstream infile;
-    infile.open(filename);
-    if (infile.fail())
+    char bytes[sizeof(T)];
+    for (unsigned int i = 0; i < sizeof(T); i++)
+        bytes[i] = p[sizeof(T) - 1 - i];
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+double load_field(const char *p, field_type_enum type, bool swap)
+{
+    switch (type)
     {
-        cout << "ERROR:  File not found.\n";
-        return false;
+        case FIELD_INT8: return load_value<signed char>(p, swap);
+        case FIELD_UINT8: return load_value<unsigned char>(p, swap);
+        case FIELD_INT16: return load_value<short>(p, swap);
+        case FIELD_UINT16: return load_value<unsigned short>(p, swap);
+        case FIELD_INT32: return load_value<int>(p, swap);
+        case FIELD_UINT32: return load_value<unsigned int>(p, swap);
+        case FIELD_FLOAT32: return load_value<float>(p, swap);
+        case FIELD_FLOAT64: return load_value<double>(p, swap);
+        default: return 0;
     }
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool read_points_binary(const char*, size_t, int, int, const int*,
+ *                                        const FieldLayout&, double*, float*)
+ *  Description:  Copy the mapped columns of num_pts fixed-size records out of data,
+ *                  converting them to the point and normal arrays.  Only the columns
+ *                  named in field_map are touched.
+ * =====================================================================================
+ */
+bool read_points_binary(const char *data, size_t num_bytes, int num_pts, int num_fields, const int *field_map, const FieldLayout &layout, double *points, float *normals)
+{
+    if (layout.stride <= 0 || num_bytes < (size_t) num_pts * layout.stride)
+        return false;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    bool swap = (layout.format == FORMAT_BINARY_LE);
+#else
+    bool swap = (layout.format == FORMAT_BINARY_BE);
+#endif
+
+    // Columns to copy: where they sit in a record and where they go
+    int num_columns = 0, offsets[2 * NDIM], targets[2 * NDIM];
+    field_type_enum types[2 * NDIM];
+    for (int i = 0; i < num_fields && num_columns < 2 * NDIM; i++)
+        if (field_map[i] >= 0 && field_map[i] < 2 * NDIM)
+        {
+            offsets[num_columns] = layout.offsets[i];
+            types[num_columns] = layout.types[i];
+            targets[num_columns] = field_map[i];
+            num_columns++;
+        }
+
+    const char *record = data;
+    for (int i = 0; i < num_pts; i++, record += layout.stride)
+        for (int k = 0; k < num_columns; k++)
+        {
+            double value = load_field(record + offsets[k], types[k], swap);
+            if (targets[k] < NDIM)
+                points[NDIM * i + targets[k]] = value;
+            else
+                normals[NDIM * i + targets[k] - NDIM] = value;
+        }
+    return true;
+}
+
+
+#define STREAM_BLOCK_POINTS (1 << 20)   // Points per block of stream_points_from_pxx
+
+/*
+ * =====================================================================================
+ *        Class:  PointReader
+ *  Description:  Reads the points of a PLY or PCD file a block at a time, through the
+ *                  memory map when there is one and through the stream otherwise.  ASCII
+ *                  blocks go through read_points_chunked and binary blocks through
+ *                  read_points_binary.
+ * =====================================================================================
+ */
+class PointReader
+{
+    ifstream infile;
+    MappedFile mapped;
+    const char *next, *end;         // Unread part of the mapped body
+    size_t body_offset;             // Start of the body in the file
+
+    int num_fields, field_map[MAX_FIELDS];
+    FieldLayout layout;
+    vector<char> buffer;            // Binary records, when the file is not mapped
+
+    PointReader(const PointReader &);
+    PointReader &operator=(const PointReader &);
+
+public:
+    int num_points,                 // Points declared by the header
+        points_read;                // Points returned so far
+    size_t bytes_read;              // Body bytes consumed so far
+    bool haveNormals, binary;
+
+    PointReader() : next(NULL), end(NULL), body_offset(0), num_fields(0), num_points(0),
+                    points_read(0), bytes_read(0), haveNormals(false), binary(false) {}
 
-    if (strcmp(&filename[strlen(filename) - 3], "pcd") == 0)
+    /* Read the header and map the body */
+    bool open(const char *filename)
     {
-        cout << "Reading PCD header.\n";
-        result = read_pcd_header(infile, num_points, num_fields, field_map, haveNormals);
+        bool result = false;
+
+        cout << "\nOpening file " << filename << ".\n";
+        infile.open(filename, ios::binary);
+        if (infile.fail())
+        {
+            cout << "ERROR:  File not found.\n";
+            return false;
+        }
+
+        if (strcmp(&filename[strlen(filename) - 3], "pcd") == 0)
+        {
+            cout << "Reading PCD header.\n";
+            result = read_pcd_header(infile, num_points, num_fields, field_map, haveNormals, layout);
+        }
+        if (strcmp(&filename[strlen(filename) - 3], "ply") == 0)
+        {
+            cout << "Reading PLY header.\n";
+            result = read_ply_header(infile, num_points, num_fields, field_map, haveNormals, layout);
+        }
+
+        if (!result)
+        {
+            cout << "ERROR:  Could not read header.\n";
+            return false;
+        }
+        if (layout.format == FORMAT_UNSUPPORTED
+            || (layout.format != FORMAT_ASCII && layout.stride <= 0))
+        {
+            cout << "ERROR:  Unsupported data encoding.\n";
+            return false;
+        }
+
+        binary = (layout.format != FORMAT_ASCII);
+        body_offset = infile.tellg();
+        if (mapped.open(filename))
+        {
+            next = mapped.data + body_offset;
+            end = mapped.data + mapped.size;
+        }
+        return true;
     }
-    if (strcmp(&filename[strlen(filename) - 3], "ply") == 0)
+
+    /* Go back to the first point */
+    void rewind()
     {
-        cout << "Reading PLY header.\n";
-        result = read_ply_header(infile, num_points, num_fields, field_map, haveNormals);
+        if (mapped.data != NULL)
+            next = mapped.data + body_offset;
+        infile.clear();
+        infile.seekg(body_offset);
+        points_read = 0;
+        bytes_read = 0;
     }
 
-    if (!result)
+    /*
+     * Read up to max_points points (NDIM coordinates and NDIM normal components each);
+     * returns the number read, 0 once all are read, or -1 if the body is malformed.
+     */
+    int read(int max_points, double *points, float *normals)
     {
-        cout << "ERROR:  Could not read header.\n";
-        return false;
+        PROFILE_SCOPE("PointReader::read");
+        int count = min(max_points, num_points - points_read);
+        if (count <= 0)
+            return 0;
+
+        bool good;
+        size_t num_bytes;
+        if (binary && mapped.data != NULL)
+        {
+            good = read_points_binary(next, end - next, count, num_fields, field_map, layout, points, normals);
+            num_bytes = (size_t) count * layout.stride;
+            next += good ? num_bytes : 0;
+        }
+        else if (binary)
+        {
+            buffer.resize((size_t) count * layout.stride);
+            infile.read(buffer.data(), buffer.size());
+            good = read_points_binary(buffer.data(), infile.gcount(), count, num_fields, field_map, layout, points, normals);
+            num_bytes = buffer.size();
+        }
+        else if (mapped.data != NULL)
+        {
+            const char *start = next;
+            good = read_points_chunked(next, end, count, num_fields, field_map, points, normals, NUM_THREADS);
+            num_bytes = next - start;
+        }
+        else
+        {
+            size_t start = infile.tellg();
+            good = read_points(infile, count, num_fields, field_map, points, normals);
+            num_bytes = (size_t) infile.tellg() - start;
+        }
+
+        if (!good)
+            return -1;
+        if (mapped.data != NULL)
+            mapped.drop(next);
+        points_read += count;
+        bytes_read += num_bytes;
+        PROFILE_COUNT("bytes_read", num_bytes);
+        return count;
     }
+};
 
-    points = new double[num_points * NDIM]();
-    normals = new float[num_points * NDIM]();
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool load_points_from_pxx(const char*, Octree&, OctreeGraph&)
+ *  Description:  Read every point of a PLY or PCD file, then add them to the tree
+ * =====================================================================================
+ */
+bool load_points_from_pxx(const char *filename, Octree &tree, OctreeGraph &graph)
+{
+    PROFILE_SCOPE("load_points_from_pxx");
+    PointReader reader;
+    if (!reader.open(filename))
+        return false;
+
+    int num_points = reader.num_points, result;
+    double *points = new double[(size_t) num_points * NDIM]();
+    float *normals = new float[(size_t) num_points * NDIM]();
 
     // Read points from the file
-    TIC("\nReading " << num_points << " points " << ternary(haveNormals, "(with normals): ", "(without normals): "))
-    read_points(infile, num_points, num_fields, field_map, points, normals);
-    TOC    
+    TIC("\nReading " << num_points << ternary(reader.binary, " binary", "") << " points "
+        << ternary(reader.haveNormals, "(with normals): ", "(without normals): "))
+    result = reader.read(num_points, points, normals);
+    TOC_RATE(reader.bytes_read)
+
+    if (result < 0 && reader.binary)
+    {
+        cout << "ERROR:  File ends before the last point.\n";
+        delete[] points;
+        delete[] normals;
+        return false;
+    }
 
     // Add points to the tree
     TIC("Building tree (depth=" << tree.max_depth << "): ")
-    if (haveNormals)
+    if (reader.haveNormals)
         tree.addPoints(points, normals, num_points, graph);
     else
         tree.addPoints(points, NULL, num_points, graph);
@@ -221,4 +858,68 @@ bool load_points_from_pxx(const char *filename, Octree &tree, OctreeGraph &graph
     return true;
 }
 
-#endif // PCD_IO_H
\ No newline at end of file
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool stream_points_from_pxx(const char*, Octree&, OctreeGraph&, int)
+ *  Description:  Add the points of a PLY or PCD file to the tree block_points at a
+ *                  time, so that only one block of raw points is ever held.  Each block
+ *                  goes into the tree as soon as it is read; the edges are linked once,
+ *                  after the last block.  If the tree has no limits yet, a first pass
+ *                  over the file finds them, since the first block alone could not.
+ * =====================================================================================
+ */
+bool stream_points_from_pxx(const char *filename, Octree &tree, OctreeGraph &graph,
+                            int block_points = STREAM_BLOCK_POINTS)
+{
+    PROFILE_SCOPE("stream_points_from_pxx");
+    PointReader reader;
+    if (!reader.open(filename))
+        return false;
+
+    int num_points = reader.num_points, count;
+    block_points = max(1, min(block_points, num_points));
+    vector<double> points((size_t) block_points * NDIM);
+    vector<float> normals((size_t) block_points * NDIM);
+
+    if (isZero(tree.getLimits(), 2 * NDIM))
+    {
+        double limits[2 * NDIM], block_limits[2 * NDIM];
+        findLimits(NULL, 0, limits);
+
+        TIC("\nFinding limits of " << num_points << " points: ")
+        while ((count = reader.read(block_points, &points[0], &normals[0])) > 0)
+        {
+            findLimits(&points[0], count, block_limits);
+            for (int j = 0; j < NDIM; j++)
+            {
+                limits[2 * j] = min(limits[2 * j], block_limits[2 * j]);
+                limits[2 * j + 1] = max(limits[2 * j + 1], block_limits[2 * j + 1]);
+            }
+        }
+        TOC_RATE(reader.bytes_read)
+
+        tree.setLimits(limits);
+        reader.rewind();
+    }
+
+    int first_new = graph.getNumVertices(), num_valid = 0;
+    TIC("\nStreaming " << num_points << ternary(reader.binary, " binary", "") << " points in blocks of "
+        << block_points << " (depth=" << tree.max_depth << "): ")
+    while ((count = reader.read(block_points, &points[0], &normals[0])) > 0)
+        num_valid += tree.insertPoints(&points[0], reader.haveNormals ? &normals[0] : NULL,
+                                       count, graph);
+    cout << "Added " << num_valid << " / " << reader.points_read << " good points ";
+    TOC_RATE(reader.bytes_read)
+
+    if (count < 0)
+        cout << "WARNING:  Point data ended early.\n";
+
+    TIC("Linking edges: ")
+    graph.updateEdges(first_new);
+    TOC
+    cout << "New tree has " << graph.getNumVertices() << " leaf-nodes and " << graph.getNumEdges() << " edges.\n";
+
+    return true;
+}
+
+#endif // PCD_IO_H
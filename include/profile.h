@@ -0,0 +1,180 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  profile.h
+ *
+ *    Description:  Named phase timers and counters, aggregated in one registry
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:41:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+/*
+ * Build with -DOCTREE_PROFILE (make clean; make PROFILE=-DOCTREE_PROFILE) to record
+ * phases and counters; otherwise PROFILE_SCOPE and PROFILE_COUNT expand to nothing and
+ * their arguments are never evaluated, and PROFILE_ONLY drops its statement.  When
+ * enabled, the registry is written as JSON at exit to $OCTREE_PROFILE_OUT, or to
+ * profile.json if that is unset.
+ *
+ * Each macro site looks its entry up once and keeps the pointer, so a recorded scope
+ * costs four clock reads and a few relaxed atomic adds.
+ */
+#ifdef OCTREE_PROFILE
+#define PROFILE_CAT_(A, B) A##B
+#define PROFILE_CAT(A, B) PROFILE_CAT_(A, B)
+
+#define PROFILE_SCOPE(NAME)                                                                 \
+    static ProfilePhase *PROFILE_CAT(profile_phase_, __LINE__) = getProfiler().phase(NAME);  \
+    ScopedTimer PROFILE_CAT(profile_timer_, __LINE__)(PROFILE_CAT(profile_phase_, __LINE__))
+
+#define PROFILE_COUNT(NAME, AMOUNT) do {                                                    \
+    static std::atomic<long> *profile_counter = getProfiler().counter(NAME);               \
+    profile_counter->fetch_add(AMOUNT, std::memory_order_relaxed);                         \
+} while (0)
+
+// Statements that only feed the profiler, such as a count taken before a phase
+#define PROFILE_ONLY(STATEMENT) STATEMENT
+#else
+#define PROFILE_SCOPE(NAME)
+#define PROFILE_COUNT(NAME, AMOUNT) do {} while (0)
+#define PROFILE_ONLY(STATEMENT)
+#endif
+
+// Console progress timing: prints MESSAGE, then "DONE (<wall ms>ms)." at TOC
+#define TIC(MESSAGE) {                  \
+cout << MESSAGE;                        \
+cout.flush();                           \
+ProfileClock TIC_TIME;
+
+#define TOC                                                                                         \
+cout << "DONE";                                                                                     \
+cout << " (" << (int) TIC_TIME.wallMs() << "ms).\n"; }
+
+// TOC that also reports the throughput over BYTES bytes
+#define TOC_RATE(BYTES)                                                                             \
+cout << "DONE";                                                                                     \
+cout << " (" << (int) TIC_TIME.wallMs() << "ms, "                                                 \
+     << (int)((BYTES) / 1e3 / std::max(TIC_TIME.wallMs(), 1e-3)) << " MB/s).\n"; }
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+long threadCpuNanoseconds();    // CPU time of the calling thread
+
+/*
+ * =====================================================================================
+ *        Class:  ProfileClock
+ *  Description:  Start of an interval on the monotonic wall clock and on the calling
+ *                  thread's CPU clock
+ * =====================================================================================
+ */
+struct ProfileClock
+{
+    std::chrono::steady_clock::time_point wall_start;
+    long cpu_start;
+
+    ProfileClock() : wall_start(std::chrono::steady_clock::now()),
+                     cpu_start(threadCpuNanoseconds()) {}
+
+    long wallNanoseconds() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - wall_start).count();
+    }
+    long cpuNanoseconds() const { return threadCpuNanoseconds() - cpu_start; }
+    double wallMs() const { return wallNanoseconds() / 1e6; }
+};
+
+/*
+ * =====================================================================================
+ *        Class:  ProfilePhase
+ *  Description:  Totals of one named phase.  self_ns excludes the time spent in phases
+ *                  opened inside it on the same thread; cpu_ns is the CPU time of the
+ *                  thread that opened the phase (work handed to the pool is not in it).
+ * =====================================================================================
+ */
+struct ProfilePhase
+{
+    std::string name;
+    std::atomic<long> calls, wall_ns, self_ns, cpu_ns, max_wall_ns;
+
+    explicit ProfilePhase(const std::string &new_name)
+        : name(new_name), calls(0), wall_ns(0), self_ns(0), cpu_ns(0), max_wall_ns(0) {}
+
+    void record(long wall, long self, long cpu);
+};
+
+/*
+ * =====================================================================================
+ *        Class:  ScopedTimer
+ *  Description:  Times its own lifetime into a phase.  Timers nest: each one knows the
+ *                  enclosing timer of its thread and charges its wall time to it, so
+ *                  that the enclosing phase's self time excludes it.
+ * =====================================================================================
+ */
+class ScopedTimer
+{
+    ProfilePhase *phase;
+    ScopedTimer *outer;         // Enclosing timer on this thread, or NULL
+    ProfileClock clock;
+    long inner_ns;              // Wall time of the timers nested directly inside
+
+    ScopedTimer(const ScopedTimer &);
+    ScopedTimer &operator=(const ScopedTimer &);
+
+public:
+    explicit ScopedTimer(ProfilePhase *new_phase);
+    ~ScopedTimer();
+};
+
+/*
+ * =====================================================================================
+ *        Class:  Profiler
+ *  Description:  Thread-safe registry of phases and counters.  Entries are created on
+ *                  first use and never move, so callers may keep the pointers.
+ * =====================================================================================
+ */
+class Profiler
+{
+    std::mutex lock;
+    std::map<std::string, ProfilePhase *> phases;
+    std::map<std::string, std::atomic<long> *> counters;
+
+public:
+    ~Profiler();
+
+    ProfilePhase *phase(const std::string &name);
+    std::atomic<long> *counter(const std::string &name);
+
+    // Totals so far (zero for names never recorded)
+    long getCalls(const std::string &name);
+    double getWallMs(const std::string &name);
+    double getCpuMs(const std::string &name);
+    long getCount(const std::string &name);
+
+    void reset();
+    void writeJson(std::ostream &out);
+    bool writeJson(const char *filename);
+};
+
+// The process-wide registry
+Profiler &getProfiler();
+
+#endif // PROFILE_H
@@ -0,0 +1,52 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  radix_sort.h
+ *
+ *    Description:  LSD radix sort of codestring keys carrying a payload index
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:05:51 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include "octree.h"
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+#define RADIX_BITS 8
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MIN_ELEMENTS 48      // Below this, insertion sort beats the histograms
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+/*
+ * A sort key and the position of the element it came from.  Sorting these instead of
+ * the elements themselves moves 16 bytes per pass rather than the whole payload.
+ */
+struct CodeIndex
+{
+    codestring code;
+    unsigned int index;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+
+/*
+ * Stable sorts by code.  Only the low num_bits of each code are examined (for octree
+ * codes, NDIM*max_depth), so codes must have no bits set above them.  The pointer form
+ * needs a scratch buffer of n entries.
+ */
+void radixSort(CodeIndex *keys, CodeIndex *scratch, int n, int num_bits);
+void radixSort(vector<CodeIndex> &keys, int num_bits);
+void radixSort(vector<codestring> &codes, int num_bits);
+
+#endif // RADIX_SORT_H
@@ -0,0 +1,117 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  snapshot.h
+ *
+ *    Description:  Memory-mappable snapshots of a built Octree and OctreeGraph
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:26:02 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "octree.h"
+#include "mapped_file.h"
+#include <stdint.h>
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+#define SNAPSHOT_MAGIC "OCTSNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_BYTE_ORDER 0x01020304u    // Reads back permuted on a foreign host
+#define SNAPSHOT_ALIGN 64                  // Every section starts on a cache line
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+enum snapshot_section_enum {SECTION_CODES,          // codestring per leaf, ascending
+                            SECTION_LOCATIONS,      // NDIM doubles per leaf
+                            SECTION_NORMALS,        // NDIM floats per leaf
+                            SECTION_NUM_POINTS,     // int32 per leaf
+                            SECTION_ADJ_OFFSETS,    // int64 per leaf, plus one
+                            SECTION_ADJ_INDICES,    // int32 per adjacency entry
+                            SECTION_ADJ_WEIGHTS,    // float per adjacency entry, if any
+                            SNAPSHOT_SECTIONS};
+
+/*
+ * File header.  Every field has a fixed width, and the struct is padded to
+ * SNAPSHOT_ALIGN bytes, so the sections that follow can be used in place.
+ */
+struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version,
+             byte_order;
+    int32_t ndim,
+            max_depth;
+    int64_t num_leaves,
+            num_adjacent;
+    double limits[2 * NDIM];
+    int32_t has_weights,
+            unused;
+    uint64_t section_offsets[SNAPSHOT_SECTIONS],
+             file_size;
+    char padding[SNAPSHOT_ALIGN - (8 + 4 * 6 + 8 * 2 + 8 * 2 * NDIM + 8 * (SNAPSHOT_SECTIONS + 1)) % SNAPSHOT_ALIGN];
+};
+
+/*
+ * =====================================================================================
+ *        Class:  OctreeSnapshot
+ *  Description:  Read-only view of a snapshot file.  The file is mapped and its
+ *                  sections are used where they lie; nothing is copied or rebuilt.
+ *                  Leaves are numbered in code order, which is also the numbering the
+ *                  adjacency uses.
+ * =====================================================================================
+ */
+class OctreeSnapshot
+{
+    MappedFile file;
+    const SnapshotHeader *header;
+
+    const codestring *codes;
+    const double *locations;
+    const float *normals;
+    const int32_t *num_points;
+    const int64_t *adj_offsets;
+    const int32_t *adj_indices;
+    const float *adj_weights;
+
+    OctreeSnapshot(const OctreeSnapshot &);
+    OctreeSnapshot &operator=(const OctreeSnapshot &);
+
+public:
+    OctreeSnapshot();
+
+    bool open(const char *filename);
+    void close();
+
+    // Accessor methods
+    int getNumLeaves() const;
+    int getMaxDepth() const;
+    const double *getLimits() const;
+    codestring getAddress(int leaf) const;
+    const double *getLocation(int leaf) const;
+    const float *getNormal(int leaf) const;
+    int getNumPoints(int leaf) const;
+
+    bool hasWeights() const;
+    int getDegree(int leaf) const;
+    Span<const int> getAdjacent(int leaf) const;
+    Span<const float> getWeights(int leaf) const;
+    long getNumAdjacent() const;
+
+    int findAddress(codestring address) const;
+};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+
+bool saveSnapshot(const char *filename, Octree &tree, OctreeGraph &graph);
+
+#endif // SNAPSHOT_H
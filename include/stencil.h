@@ -0,0 +1,66 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  stencil.h
+ *
+ *    Description:  Kernels over the FOOT stencil, specialized at compile time for the
+ *                  common footprints
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:02:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include "octree.h"
+
+/* #####   EXPORTED MACROS   ######################################################## */
+
+#define STENCIL_MAX_FOOT 3      // Largest FOOT with a compiled-in kernel
+
+/* #####   EXPORTED TYPE DEFINITIONS   ############################################## */
+
+/*
+ * GENERIC reads FOOT at run time.  FIXED uses the kernel compiled for the current FOOT,
+ * whose offset tables are constants and whose loops have fixed trip counts, and falls
+ * back to GENERIC when FOOT is above STENCIL_MAX_FOOT.  Both give identical results.
+ */
+enum stencil_enum {STENCIL_GENERIC, STENCIL_FIXED};
+
+/* #####   EXPORTED FUNCTION DECLARATIONS   ######################################### */
+
+// Position of an offset in the stencil, x fastest (the centre is NNEI/2, and -offset
+// is NNEI-1 minus it); -1 if the offset is more than FOOT along some axis
+inline int stencilSlot(const int relative_coords[NDIM])
+{
+    int slot = 0;
+    for (int j = NDIM - 1; j >= 0; j--)
+    {
+        if (relative_coords[j] < -FOOT || relative_coords[j] > FOOT)
+            return -1;
+        slot = slot * DIAM + relative_coords[j] + FOOT;
+    }
+    return slot;
+}
+
+// Sorted codes of the in-volume voxels of the stencil around code, the centre left
+// out, each voxel once even when FOOT is as wide as the grid.  out needs room for NNEI
+// codes; returns how many were written.
+int stencilCodes(codestring code, int max_depth, codestring *out);
+
+// The FOOT whose kernel the current path runs (0: the generic one)
+int stencilFoot();
+
+// Path selection (FIXED by default)
+void setStencilPath(stencil_enum path);
+stencil_enum getStencilPath();
+const char *stencilPathName(stencil_enum path);
+
+#endif // STENCIL_H
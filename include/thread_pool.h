@@ -0,0 +1,87 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  thread_pool.h
+ *
+ *    Description:  Fork-join work-stealing thread pool
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 01:25:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/*
+ * =====================================================================================
+ *        Class:  ThreadPool
+ *  Description:  Runs batches of indexed tasks.  Each participant (the calling thread is
+ *                  participant 0) has its own deque of task indices; it pops from the
+ *                  back of its own and steals from the front of the others' when it
+ *                  runs dry.  run() returns once every task in the batch has finished.
+ *
+ *                  Concurrency: any thread may call run().  Batches from different
+ *                  threads take turns; one waits for the other to finish.  A run()
+ *                  made from inside a task (on a worker, or on the caller while it
+ *                  helps with its own batch) does not queue a second batch; it runs
+ *                  its tasks inline on the calling thread.
+ * =====================================================================================
+ */
+class ThreadPool
+{
+    struct TaskQueue
+    {
+        std::mutex lock;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<TaskQueue *> queues;        // One per participant
+
+    std::mutex batch_lock;                  // Held by the caller of run() for its batch
+    std::mutex lock;
+    std::condition_variable wake_workers,   // A new batch is queued, or shutting down
+                            batch_done;     // The last task of the batch has finished
+    const std::function<void(int)> *job;    // Task body of the current batch
+    int generation,                         // Number of batches started
+        remaining;                          // Tasks of the current batch not yet finished
+    bool stopping;
+
+    ThreadPool(const ThreadPool &);
+    ThreadPool &operator=(const ThreadPool &);
+
+public:
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    void run(int num_tasks, const std::function<void(int)> &task);
+
+    int getNumThreads() const;
+    static int currentWorker();     // Participant index of the calling thread (0 outside)
+
+private:
+    void workerLoop(int id);
+    bool runOne(int id);
+};
+
+/*
+ * Shared pool with the given number of participants.  There is one pool per count, made
+ * on first use and kept until exit, so the reference stays valid when another thread
+ * asks for a different count.
+ */
+ThreadPool &getThreadPool(int num_threads);
+
+#endif // THREAD_POOL_H
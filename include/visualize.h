@@ -4,6 +4,11 @@
 #include "octree.h"
 #include <iomanip>
 #include <fstream>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define PLY_BUFFER_BYTES (1 << 22)   // Bytes collected before each write(2)
 
 const double colours[5][3] =
 {
@@ -16,11 +21,95 @@ const double colours[5][3] =
 
 // ######################################################################
 void rainbow(float r, unsigned int *color);
+void outputVisualizationBinary(OctreeGraph &graph, const char *outfile);
+
+/*
+ * =====================================================================================
+ *        Class:  PlyWriter
+ *  Description:  Appends raw little-endian values to a large buffer and hands it to
+ *                  write(2) whenever it fills, so a binary PLY body costs one system
+ *                  call per PLY_BUFFER_BYTES and no formatting.
+ * =====================================================================================
+ */
+class PlyWriter
+{
+    int fd;
+    vector<char> buffer;
+    size_t used;
+    bool failed;
+
+public:
+    PlyWriter() : fd(-1), used(0), failed(false) {}
+    ~PlyWriter() { close(); }
+
+    bool open(const char *filename)
+    {
+        fd = ::open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        buffer.resize(PLY_BUFFER_BYTES);
+        used = 0;
+        failed = (fd < 0);
+        return !failed;
+    }
+
+    void write(const void *data, size_t bytes)
+    {
+        if (used + bytes > buffer.size())
+            flush();
+        memcpy(&buffer[used], data, bytes);
+        used += bytes;
+    }
+
+    void write(const string &text) { write(text.data(), text.size()); }
+
+    template<typename T>
+    void put(T value)
+    {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        char bytes[sizeof(T)], swapped[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        for (unsigned int i = 0; i < sizeof(T); i++)
+            swapped[i] = bytes[sizeof(T) - 1 - i];
+        write(swapped, sizeof(T));
+#else
+        write(&value, sizeof(T));
+#endif
+    }
+
+    void flush()
+    {
+        for (size_t done = 0; done < used && !failed; )
+        {
+            ssize_t written = ::write(fd, &buffer[done], used - done);
+            if (written <= 0)
+                failed = true;
+            else
+                done += written;
+        }
+        used = 0;
+    }
+
+    /* Flush and close; false if any write failed */
+    bool close()
+    {
+        if (fd < 0)
+            return !failed;
+        flush();
+        ::close(fd);
+        fd = -1;
+        return !failed;
+    }
+};
 
 // ######################################################################
 void outputVisualization(OctreeGraph &graph, int imnum, const char *outfile)
 {
     init_viz(); // get parameters from config file
+    if (plyformat == BINARY_PLY)
+    {
+        cout << "saving image " << imnum << " at " << outfile << " (binary)" << endl;
+        outputVisualizationBinary(graph, outfile);
+        return;
+    }
 
     cout << "saving image " << imnum << " at " << outfile << endl;
     fstream out(outfile, fstream::out);
@@ -57,17 +146,14 @@ void outputVisualization(OctreeGraph &graph, int imnum, const char *outfile)
 
     int depth = graph.getVertex(0)->getDepth();
     int prec = ceil(.75 * depth);
-    vector<OctreePoint *> vertices = graph.getVertices();
+    vector<OctreePoint *> &vertices = graph.getVertices();
     for (int n = 0; n < point_mult; n++)
         for (unsigned int i = 0; i < vertices.size(); i++)
         {
             out << setprecision(prec) << fixed;
 
-            const double *location;
-            if (loctype == NOMINAL)
-                location = vertices[i]->getNomLocation();
-            if (loctype == AVERAGE)
-                location = vertices[i]->getLocation();
+            const double *location = (loctype == NOMINAL) ? vertices[i]->getNomLocation()
+                                                          : vertices[i]->getLocation();
 
                            // coordinates
             for (int j = 0; j < 3; j++)            
@@ -88,11 +174,8 @@ void outputVisualization(OctreeGraph &graph, int imnum, const char *outfile)
 
         for (unsigned int i = 0; i < vertices.size(); i++)
         {
-            const double *location;
-            if (loctype == NOMINAL)
-                location = vertices[i]->getNomLocation();
-            else // (loctype == AVERAGE)
-                location = vertices[i]->getLocation();
+            const double *location = (loctype == NOMINAL) ? vertices[i]->getNomLocation()
+                                                          : vertices[i]->getLocation();
 
             for (int j = 0; j < 3; j++)
             {
@@ -124,7 +207,7 @@ void outputVisualization(OctreeGraph &graph, int imnum, const char *outfile)
     // edges
     if (edgetype == GRAPH)
     {
-        vector<OctreeEdge *> edges = graph.getEdges();
+        vector<OctreeEdge *> &edges = graph.getEdges();
         for (unsigned int i = 0; i < edges.size(); i++)
         {
             OctreePoint *p1 = edges[i]->p1, *p2 = edges[i]->p2;
@@ -139,6 +222,105 @@ void outputVisualization(OctreeGraph &graph, int imnum, const char *outfile)
     out.close();
 }
 
+// ######################################################################
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void outputVisualizationBinary(OctreeGraph&, const char*)
+ *  Description:  The same vertices and faces as outputVisualization, written as
+ *                  binary_little_endian: 15 bytes per vertex (3 float32, 3 uchar) and
+ *                  13 bytes per face (uchar 3, 3 int32).  Colours are truncated to
+ *                  uchar, as a reader of the ASCII file would have to.
+ * =====================================================================================
+ */
+void outputVisualizationBinary(OctreeGraph &graph, const char *outfile)
+{
+    PlyWriter out;
+    if (!out.open(outfile))
+    {
+        cout << "ERROR:  Could not open " << outfile << " for writing.\n";
+        return;
+    }
+
+    vector<OctreePoint *> &vertices = graph.getVertices();
+    int num_points = graph.getNumVertices();
+    int n_copies = (edgetype > 0) ? 3 : 1;
+    int point_mult = (edgetype == NORMALS) ? n_copies - 1 : n_copies;
+
+    ostringstream header;
+    header << "ply\n"
+           << "format binary_little_endian 1.0\n"
+           << "comment written by ucla vision lab solid objects\n"
+           << "element vertex " << n_copies * num_points << "\n"
+           << "property float32 x\n"
+           << "property float32 y\n"
+           << "property float32 z\n"
+           << "property uchar red\n"
+           << "property uchar green\n"
+           << "property uchar blue\n";
+    if (edgetype == GRAPH)
+        header << "element face " << graph.getNumEdges() << "\n";
+    if (edgetype == NORMALS)
+        header << "element face " << num_points << "\n";
+    if (edgetype > 0)
+        header << "property list uchar int vertex_index\n";
+    header << "end_header\n";
+    out.write(header.str());
+
+    for (int n = 0; n < point_mult; n++)
+        for (int i = 0; i < num_points; i++)
+        {
+            const double *location = (loctype == NOMINAL) ? vertices[i]->getNomLocation()
+                                                          : vertices[i]->getLocation();
+            for (int j = 0; j < 3; j++)
+                out.put((float) location[j]);
+            for (int j = 0; j < 3; j++)
+                out.put((unsigned char) vertices[i]->color[j]);
+        }
+
+    if (edgetype == NORMALS)
+    {
+        double normal_length = 0;
+        if (num_points > 0)
+            normal_length = 1 / ((double) (1 << vertices[0]->getDepth()));
+
+        for (int i = 0; i < num_points; i++)
+        {
+            const double *location = (loctype == NOMINAL) ? vertices[i]->getNomLocation()
+                                                          : vertices[i]->getLocation();
+            const float *normal = vertices[i]->getNormal();
+            for (int j = 0; j < 3; j++)
+                out.put((float) (isnan(normal[j]) ? location[j]
+                                                  : location[j] + normal_length * normal[j]));
+            for (int j = 0; j < 3; j++)
+                out.put((unsigned char) 255);
+        }
+
+        for (int i = 0; i < num_points; i++)
+        {
+            out.put((unsigned char) 3);
+            out.put((int) i);
+            out.put((int) (i + num_points));
+            out.put((int) (i + 2 * num_points));
+        }
+    }
+
+    if (edgetype == GRAPH)
+    {
+        vector<OctreeEdge *> &edges = graph.getEdges();
+        for (unsigned int i = 0; i < edges.size(); i++)
+        {
+            int p1 = edges[i]->p1->getIndex(), p2 = edges[i]->p2->getIndex();
+            out.put((unsigned char) 3);
+            out.put(p1);
+            out.put(p2);
+            out.put(p1 + num_points);
+        }
+    }
+
+    if (!out.close())
+        cout << "ERROR:  Could not write " << outfile << ".\n";
+}
+
 // ######################################################################
 void rainbow(float r, unsigned int *color)
 {
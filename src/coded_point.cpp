@@ -16,6 +16,8 @@
  * =====================================================================================
  */
 #include "octree.h"
+#include "morton.h"
+#include "radix_sort.h"
 #include <iomanip>
 
 /* #####   Constructors   ########################################################### */
@@ -35,10 +37,12 @@ CodedPoint::CodedPoint(const double *new_location, const float *new_normal, cons
 
     for (int j = 0; j < NDIM; j++)
     {
-    	good_point = good_point && ((location[j]>=limits[2*j])&&(location[j]<=limits[2*j+1]));
     	location[j] = new_location[j];
+    	good_point = good_point && ((location[j]>=limits[2*j])&&(location[j]<=limits[2*j+1]));
         double dx = (limits[2 * j + 1] - limits[2 * j]) / (1 << max_depth);
-        int_location[j] = floor((location[j] - limits[2 * j]) / dx);    	
+        int_location[j] = floor((location[j] - limits[2 * j]) / dx);
+        if (int_location[j] == (1l << max_depth))  // upper face belongs to the last voxel
+            int_location[j]--;    	
         normal[j] = new_normal[j];
     }
     code = locationToCode(int_location, max_depth);
@@ -49,10 +53,12 @@ CodedPoint::CodedPoint(const double *new_location, const double *limits, int max
 	good_point=true;
     for (int j = 0; j < NDIM; j++)
     {
-    	good_point = good_point && ((location[j]>=limits[2*j])&&(location[j]<=limits[2*j+1]));
     	location[j] = new_location[j];
+    	good_point = good_point && ((location[j]>=limits[2*j])&&(location[j]<=limits[2*j+1]));
         double dx = (limits[2 * j + 1] - limits[2 * j]) / (1 << max_depth);
-        int_location[j] = floor((location[j] - limits[2 * j]) / dx); 
+        int_location[j] = floor((location[j] - limits[2 * j]) / dx);
+        if (int_location[j] == (1l << max_depth))  // upper face belongs to the last voxel
+            int_location[j]--; 
         normal[j] = 0;
     }
     code = locationToCode(int_location, max_depth);
@@ -132,20 +138,7 @@ ostream &operator<<(ostream &out, const CodedPoint &p)
  */
 void codeToLocation(codestring code, long *location, int max_depth)
 {
-    for (int i = 0; i < NDIM; i++)
-        location[i] = 0;
-
-    codestring new_code = code;
-    int out_bit = 1;
-    for (int i = 0; i < max_depth; i++)
-    {
-        for (int j = 0; j < NDIM; j++)
-        {
-            location[j] |= out_bit * (new_code & 1);
-            new_code >>= 1;
-        }
-        out_bit <<= 1;
-    }
+    mortonDecode(code, location, max_depth);
 }
 
 
@@ -157,25 +150,7 @@ void codeToLocation(codestring code, long *location, int max_depth)
  */
 codestring locationToCode(const long *location, int max_depth)
 {
-    int new_location[NDIM];
-    for (int i = 0; i < NDIM; i++)
-        new_location[i] = location[i];
-
-    /* Thread the location bits into a single codestring */
-    codestring code = 0;
-    codestring out_bit = 1;
-    for (int i = 0; i < max_depth; i++)
-    {
-        for (int j = 0; j < NDIM; j++)
-        {
-            code |= out_bit * (new_location[j] & 1);
-
-            out_bit <<= 1;
-            new_location[j] >>= 1;
-        }
-    }
-
-    return code;
+    return mortonEncode(location, max_depth);
 }
 
 
@@ -187,20 +162,11 @@ codestring locationToCode(const long *location, int max_depth)
  */
 codestring locationToCodeDestructive(long *location, int max_depth)
 {
+    codestring code = mortonEncode(location, max_depth);
 
-    /* Thread the location bits into a single codestring */
-    codestring code = 0;
-    codestring out_bit = 1;
-    for (int i = 0; i < max_depth; i++)
-    {
-        for (int j = 0; j < NDIM; j++)
-        {
-            code |= out_bit * (location[j] & 1);
-
-            out_bit <<= 1;
-            location[j] >>= 1;
-        }
-    }
+    /* Leave the input shifted past the consumed bits, as the bit loop did */
+    for (int j = 0; j < NDIM; j++)
+        location[j] >>= max_depth;
 
     return code;
 }
@@ -218,3 +184,34 @@ bool operator<(const CodedPoint &p1, const CodedPoint &p2)
     return (p1.code < p2.code); // || (p1.code==p2.code && p1.frame<p2.frame));
 }
 
+
+/* #####   Sorting   ################################################################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void sortPoints(PointBuffer&, int)
+ *  Description:  Stable sort of CodedPoints by code.  Only (code, index) pairs take
+ *                  part in the radix passes; the points are gathered once at the end.
+ * =====================================================================================
+ */
+void sortPoints(PointBuffer &points, int max_depth)
+{
+    int n = points.size();
+    if (n < 2)
+        return;
+
+    vector<CodeIndex> keys(n);
+    for (int i = 0; i < n; i++)
+    {
+        keys[i].code = points[i].code;
+        keys[i].index = i;
+    }
+
+    radixSort(keys, NDIM * max_depth);
+
+    PointBuffer sorted;
+    sorted.reserve(n);
+    for (int i = 0; i < n; i++)
+        sorted.push_back(points[keys[i].index]);
+    points.swap(sorted);
+}
@@ -1,48 +1,259 @@
-#include "octree.h"
-#include <queue>
+/*
+ * =====================================================================================
+ *
+ *       Filename:  graph_traverse.cpp
+ *
+ *    Description:  Dijkstra shortest paths over an OctreeGraph
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:40:18 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "graph_traverse.h"
 #include <cmath>
 #include <iomanip>
-	
-vector<double> dist_from(OctreePoint *start, OctreeGraph &graph, vector<int> &previous, 
-	DistFunction df=point_distance,	double MAX_DIST=numeric_limits<double>::infinity()){
 
-	vector<OctreePoint*>& vertices = graph.getVertices();
-	previous.resize(vertices.size());
-	for (unsigned int i = 0; i < previous.size(); i++)
-		previous[i] = i;
+/* #####   INDEXED_HEAP  -  MEMBER FUNCTION DEFINITIONS   ########################### */
 
-	vector<double> distances;
-	distances.resize(graph.getNumVertices(), MAX_DIST);
+/* Size the position table for a graph of num_vertices vertices, emptying the heap */
+void IndexedHeap::resize(int num_vertices)
+{
+    heap.clear();
+    keys.clear();
+    position.assign(num_vertices, -1);
+}
+
+/* Empty the heap, touching only the vertices still queued */
+void IndexedHeap::clear()
+{
+    for (unsigned int i = 0; i < heap.size(); i++)
+        position[heap[i]] = -1;
+    heap.clear();
+    keys.clear();
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  IndexedHeap
+ *      Method:  void pushOrDecrease(int, double)
+ * Description:  Queue v with the given key, or lower its key if it is already queued.
+ *                  Keys are never raised.
+ *--------------------------------------------------------------------------------------
+ */
+void IndexedHeap::pushOrDecrease(int v, double key)
+{
+    int slot = position[v];
+    if (slot < 0)
+    {
+        slot = heap.size();
+        heap.push_back(v);
+        keys.push_back(key);
+        position[v] = slot;
+    }
+    else
+        keys[slot] = key;
+
+    siftUp(slot);
+}
+
+/* Remove and return the vertex with the smallest key */
+int IndexedHeap::pop()
+{
+    int v = heap[0];
+    position[v] = -1;
+
+    int last = heap.back();
+    double last_key = keys.back();
+    heap.pop_back();
+    keys.pop_back();
+
+    if (!heap.empty())
+    {
+        place(0, last, last_key);
+        siftDown(0);
+    }
+    return v;
+}
+
+void IndexedHeap::siftUp(int slot)
+{
+    int v = heap[slot];
+    double key = keys[slot];
+
+    while (slot > 0)
+    {
+        int parent = (slot - 1) / HEAP_ARITY;
+        if (keys[parent] <= key)
+            break;
+        place(slot, heap[parent], keys[parent]);
+        slot = parent;
+    }
+    place(slot, v, key);
+}
+
+void IndexedHeap::siftDown(int slot)
+{
+    int v = heap[slot], size = heap.size();
+    double key = keys[slot];
+
+    while (true)
+    {
+        int first = HEAP_ARITY * slot + 1;
+        if (first >= size)
+            break;
 
-	priority_queue<OctreePoint*> pq;
-	pq.emplace(start);
-	distances[start->getIndex()] = 0;
+        /* Smallest of the (up to HEAP_ARITY) children */
+        int last = min(first + HEAP_ARITY, size), best = first;
+        for (int c = first + 1; c < last; c++)
+            if (keys[c] < keys[best])
+                best = c;
 
-	while (!pq.empty()) {
-		//       cout<<"size: "<<pq.size()<<endl; cout.flush();
-		OctreePoint* base = pq.top();
-		pq.pop();
+        if (keys[best] >= key)
+            break;
+        place(slot, heap[best], keys[best]);
+        slot = best;
+    }
+    place(slot, v, key);
+}
+
+void IndexedHeap::place(int slot, int v, double key)
+{
+    heap[slot] = v;
+    keys[slot] = key;
+    position[v] = slot;
+}
+
+/* #####   PATH_WORKSPACE  -  MEMBER FUNCTION DEFINITIONS   ######################### */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  PathWorkspace
+ *      Method:  void reset(int)
+ * Description:  Restore the defaults for a graph of num_vertices vertices.  When the
+ *                  size is unchanged only the entries the last query touched are reset.
+ *--------------------------------------------------------------------------------------
+ */
+void PathWorkspace::reset(int num_vertices)
+{
+    if ((int) distances.size() != num_vertices)
+    {
+        distances.assign(num_vertices, numeric_limits<double>::infinity());
+        previous.resize(num_vertices);
+        for (int i = 0; i < num_vertices; i++)
+            previous[i] = i;
+        heap.resize(num_vertices);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < touched.size(); i++)
+        {
+            distances[touched[i]] = numeric_limits<double>::infinity();
+            previous[touched[i]] = touched[i];
+        }
+        heap.clear();
+    }
+
+    touched.clear();
+    relaxations = 0;
+    settled = 0;
+}
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
 
-		int base_index = base->getIndex();
-	
-		// Iterate through neighbors
-		for (unsigned int i = 0; i < base->getNeighbors().size(); i++) {
-			OctreePoint* neighbor = base->getNeighbor(i);
-			if (neighbor == NULL || neighbor == base)
-				continue;			
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void dist_from(OctreePoint*, OctreeGraph&, PathWorkspace&, DistFunction,
+ *                               double)
+ *  Description:  Dijkstra from start, over the CSR arrays if the graph has them and
+ *                  over the neighbor lists otherwise.  Edge lengths come from df, or,
+ *                  when df is NULL, from the weights stored by buildAdjacency.  Paths of
+ *                  length MAX_DIST or more are never queued, so the search stops as soon
+ *                  as the heap minimum would pass MAX_DIST.
+ * =====================================================================================
+ */
+void dist_from(OctreePoint *start, OctreeGraph &graph, PathWorkspace &work,
+               DistFunction df, double MAX_DIST)
+{
+    vector<double> &distances = work.distances;
+    vector<int> &previous = work.previous;
+    IndexedHeap &heap = work.heap;
 
-			int neighbor_index = neighbor->getIndex();
-			double new_distance = distances[base_index] + df(base, neighbor);
+    PROFILE_SCOPE("dist_from");
+    work.reset(graph.getNumVertices());
 
-			if ((new_distance < distances[neighbor_index])  && new_distance < MAX_DIST) {
-				pq.emplace(neighbor);
-				distances[neighbor_index]   = new_distance;
-				previous[neighbor_index]    = base_index;
-			}
-		}
-	}
+    bool use_csr = graph.hasAdjacency(),
+         use_weights = (df == NULL) && use_csr && graph.hasWeights();
+    if (df == NULL && !use_weights)
+        df = point_distance;
+
+    int start_index = start->getIndex();
+    distances[start_index] = 0;
+    work.touched.push_back(start_index);
+    heap.pushOrDecrease(start_index, 0);
+
+    while (!heap.empty() && heap.topKey() < MAX_DIST)
+    {
+        int base_index = heap.pop();
+        OctreePoint *base = graph.getVertex(base_index);
+        double base_distance = distances[base_index];
+        work.settled++;
+
+        int degree = use_csr ? graph.getDegree(base_index) : base->getNeighbors().size();
+        Span<const int> adjacent;
+        Span<const float> weights;
+        if (use_csr)
+            adjacent = graph.getAdjacent(base_index);
+        if (use_weights)
+            weights = graph.getWeights(base_index);
+
+        for (int i = 0; i < degree; i++)
+        {
+            OctreePoint *neighbor = use_csr ? graph.getVertex(adjacent[i]) : base->getNeighbor(i);
+            if (neighbor == NULL || neighbor == base)
+                continue;
+
+            int neighbor_index = neighbor->getIndex();
+            double new_distance = base_distance
+                                  + (use_weights ? weights[i] : df(base, neighbor));
+
+            if (new_distance < distances[neighbor_index] && new_distance < MAX_DIST)
+            {
+                if (distances[neighbor_index] == numeric_limits<double>::infinity())
+                    work.touched.push_back(neighbor_index);
+                distances[neighbor_index] = new_distance;
+                previous[neighbor_index] = base_index;
+                heap.pushOrDecrease(neighbor_index, new_distance);
+                work.relaxations++;
+            }
+        }
+    }
+    PROFILE_COUNT("dijkstra_relaxations", work.relaxations);
+    PROFILE_COUNT("dijkstra_settled", work.settled);
+}
 
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  vector<double> dist_from(OctreePoint*, OctreeGraph&, vector<int>&,
+ *                                         DistFunction, double)
+ *  Description:  One-off query with fresh buffers; unreached vertices get MAX_DIST
+ * =====================================================================================
+ */
+vector<double> dist_from(OctreePoint *start, OctreeGraph &graph, vector<int> &previous,
+                         DistFunction df, double MAX_DIST)
+{
+    PathWorkspace work;
+    dist_from(start, graph, work, df, MAX_DIST);
 
+    for (unsigned int i = 0; i < work.distances.size(); i++)
+        if (work.distances[i] > MAX_DIST)
+            work.distances[i] = MAX_DIST;
 
-	return distances;
+    previous.swap(work.previous);
+    return work.distances;
 }
@@ -0,0 +1,296 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  linear_octree.cpp
+ *
+ *    Description:  Pointerless octree stored as a sorted array of occupied leaf codes
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:20:47 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "linear_octree.h"
+#include "stencil.h"
+
+/* #####   Constructors   ########################################################### */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  LinearOctree(const double*, int)
+ * Description:  Construct an empty tree over the given volume
+ *--------------------------------------------------------------------------------------
+ */
+LinearOctree::LinearOctree(const double *new_limits, int new_max_depth)
+{
+    max_depth = new_max_depth;
+    for (int i = 0; i < 2 * NDIM; i++)
+        limits[i] = new_limits[i];
+}
+
+/* #####   Initializers   ########################################################### */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  void addPoints(const double*, const float*, int)
+ * Description:  Add new points to the tree, merging them into the sorted leaf arrays
+ *--------------------------------------------------------------------------------------
+ */
+void LinearOctree::addPoints(const double *new_points, const float *new_normals,
+                             int num_new_points)
+{
+    if (isZero(limits, 2 * NDIM))
+        findLimits(new_points, num_new_points, limits);
+
+    /* 1. Create a vector of CodedPoints */
+    PointBuffer new_codes;
+    new_codes.reserve(num_new_points);
+    for (int i = 0; i < num_new_points; i++)
+    {
+        CodedPoint new_point;
+        if (new_normals != NULL)
+            new_point = CodedPoint(&new_points[i * NDIM], &new_normals[i * NDIM], limits,
+                                   max_depth);
+        else
+            new_point = CodedPoint(&new_points[i * NDIM], limits, max_depth);
+
+        if (new_point.good_point)
+            new_codes.push_back(new_point);
+    }
+
+    /* 2. Sort the vector */
+    sortPoints(new_codes, max_depth);
+
+    /* 3. Merge runs of equal codes with the existing leaves, into arrays sized for the
+     * leaves rather than the points: the old leaves plus each distinct new code */
+    int num_old = codes.size(), num_leaves = num_old;
+    for (PointIter curr = new_codes.begin(); curr != new_codes.end(); curr++)
+        if ((curr == new_codes.begin() || (curr - 1)->code != curr->code)
+            && !binary_search(codes.begin(), codes.end(), curr->code))
+            num_leaves++;
+
+    vector<codestring> old_codes;
+    vector<double> old_locations;
+    vector<float> old_normals;
+    vector<int> old_num_points;
+    codes.swap(old_codes);
+    locations.swap(old_locations);
+    normals.swap(old_normals);
+    num_points.swap(old_num_points);
+
+    codes.reserve(num_leaves);
+    locations.reserve(NDIM * num_leaves);
+    normals.reserve(NDIM * num_leaves);
+    num_points.reserve(num_leaves);
+
+    int old_leaf = 0;
+    PointIter begin = new_codes.begin();
+    while (old_leaf < num_old || begin != new_codes.end())
+    {
+        bool take_old = (old_leaf < num_old)
+                        && (begin == new_codes.end() || old_codes[old_leaf] <= begin->code);
+        bool take_new = (begin != new_codes.end())
+                        && (old_leaf == num_old || begin->code <= old_codes[old_leaf]);
+
+        if (take_old)
+        {
+            codes.push_back(old_codes[old_leaf]);
+            for (int j = 0; j < NDIM; j++)
+            {
+                locations.push_back(old_locations[NDIM * old_leaf + j]);
+                normals.push_back(old_normals[NDIM * old_leaf + j]);
+            }
+            num_points.push_back(old_num_points[old_leaf]);
+            old_leaf++;
+        }
+        else
+        {
+            codes.push_back(begin->code);
+            for (int j = 0; j < NDIM; j++)
+            {
+                locations.push_back(0);
+                normals.push_back(0);
+            }
+            num_points.push_back(0);
+        }
+
+        if (take_new)
+        {
+            PointIter end = begin;
+            while (end != new_codes.end() && end->code == begin->code)
+                end++;
+
+            accumulate(codes.size() - 1, begin, end);
+            begin = end;
+        }
+    }
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  void accumulate(int, const PointIter, const PointIter)
+ * Description:  Fold a run of CodedPoints into a leaf, as OctreePoint::add does
+ *--------------------------------------------------------------------------------------
+ */
+void LinearOctree::accumulate(int leaf, const PointIter begin, const PointIter end)
+{
+    double *location = &locations[NDIM * leaf];
+    float *normal = &normals[NDIM * leaf];
+
+    int old_num_points = num_points[leaf];
+    num_points[leaf] += end - begin;
+
+    if (old_num_points < ENOUGH_POINTS)
+    {
+        for (int i = 0; i < NDIM; i++)
+        {
+            location[i] *= old_num_points;
+            normal[i] *= old_num_points;
+        }
+
+        for (PointIter curr = begin; curr != end && old_num_points < ENOUGH_POINTS; curr++)
+        {
+            for (int i = 0; i < NDIM; i++)
+            {
+                location[i] += curr->location[i];
+                normal[i] += curr->normal[i];
+            }
+            old_num_points++;
+        }
+        for (int i = 0; i < NDIM; i++)
+        {
+            location[i] /= old_num_points;
+            normal[i] /= old_num_points;
+        }
+    }
+}
+
+/* #####   Queries   ################################################################ */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  int searchCodes(codestring, int, int)
+ * Description:  Binary search for a code among leaves [begin, end); -1 if absent
+ *--------------------------------------------------------------------------------------
+ */
+int LinearOctree::searchCodes(codestring address, int begin, int end) const
+{
+    vector<codestring>::const_iterator found =
+        lower_bound(codes.begin() + begin, codes.begin() + end, address);
+
+    if (found == codes.begin() + end || *found != address)
+        return -1;
+    return found - codes.begin();
+}
+
+int LinearOctree::findPoint(const double *location) const
+{
+    CodedPoint new_point(location, limits, max_depth);
+    return findAddress(new_point.get_code());
+}
+
+int LinearOctree::findAddress(codestring address) const
+{
+    return searchCodes(address, 0, codes.size());
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  void findRange(codestring, int, int&, int&)
+ * Description:  Find the leaves [begin, end) below the depth-level node containing the
+ *                  given address
+ *--------------------------------------------------------------------------------------
+ */
+void LinearOctree::findRange(codestring address, int depth, int &begin, int &end) const
+{
+    codestring span = ((codestring) 1) << (NDIM * (max_depth - depth));
+    codestring prefix = address & ~(span - 1);
+
+    begin = lower_bound(codes.begin(), codes.end(), prefix) - codes.begin();
+    end = lower_bound(codes.begin() + begin, codes.end(), prefix + span) - codes.begin();
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  LinearOctree
+ *      Method:  void findNeighbors(int, vector<int>&)
+ * Description:  Find the occupied leaves in the FOOT-radius cube around a leaf, in
+ *                  code order
+ *--------------------------------------------------------------------------------------
+ */
+void LinearOctree::findNeighbors(int leaf, vector<int> &neighbors) const
+{
+    neighbors.resize(0);
+
+    // 1. Build the sorted list of addresses
+    static thread_local vector<codestring> neighbor_codes;
+    neighbor_codes.resize(NNEI);
+    neighbor_codes.resize(stencilCodes(codes[leaf], max_depth, &neighbor_codes[0]));
+    if (neighbor_codes.empty())
+        return;
+
+    // 2. Restrict the search to the leaves between the smallest and largest stencil code
+    int begin = lower_bound(codes.begin(), codes.end(), neighbor_codes.front()) - codes.begin();
+    int end = upper_bound(codes.begin() + begin, codes.end(), neighbor_codes.back())
+              - codes.begin();
+
+    // 3. Sweep the sorted codes against the leaves
+    for (unsigned int i = 0; i < neighbor_codes.size() && begin < end; i++)
+    {
+        begin = lower_bound(codes.begin() + begin, codes.begin() + end, neighbor_codes[i])
+                - codes.begin();
+        if (begin < end && codes[begin] == neighbor_codes[i])
+            neighbors.push_back(begin);
+    }
+}
+
+/* #####   Accessors   ############################################################## */
+
+int LinearOctree::getNumLeaves() const
+{
+    return codes.size();
+}
+
+codestring LinearOctree::getAddress(int leaf) const
+{
+    return codes[leaf];
+}
+
+const double *LinearOctree::getLocation(int leaf) const
+{
+    return &locations[NDIM * leaf];
+}
+
+const float *LinearOctree::getNormal(int leaf) const
+{
+    return &normals[NDIM * leaf];
+}
+
+int LinearOctree::getNumPoints(int leaf) const
+{
+    return num_points[leaf];
+}
+
+const double *LinearOctree::getLimits() const
+{
+    return limits;
+}
+
+/* Bytes held by the leaf arrays */
+size_t LinearOctree::memoryUsage() const
+{
+    return codes.capacity() * sizeof(codestring)
+           + locations.capacity() * sizeof(double)
+           + normals.capacity() * sizeof(float)
+           + num_points.capacity() * sizeof(int);
+}
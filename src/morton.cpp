@@ -0,0 +1,398 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  morton.cpp
+ *
+ *    Description:  Morton codec with loop, magic-bits, lookup-table and BMI2 paths
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 09:14:02 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "morton.h"
+#include <atomic>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MORTON_X86
+#include <immintrin.h>
+#endif
+
+/* #####   Helper Functions   ####################################################### */
+
+/* Mask off the bits of a coordinate that land in a code of the given depth */
+static inline codestring axisMask(int max_depth)
+{
+    return (((codestring) 1) << max_depth) - 1;
+}
+
+/* Mask off the bits of a code of the given depth */
+static inline codestring codeMask(int max_depth)
+{
+    return (((codestring) 1) << (NDIM * max_depth)) - 1;
+}
+
+/* Spread the low 21 bits of x so that there are two zeros between each */
+static inline codestring spreadBits(codestring x)
+{
+    x &= 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2)  & 0x1249249249249249ULL;
+    return x;
+}
+
+/* Inverse of spreadBits: gather every third bit into the low 21 bits */
+static inline codestring compactBits(codestring x)
+{
+    x &= 0x1249249249249249ULL;
+    x = (x ^ (x >> 2))  & 0x10c30c30c30c30c3ULL;
+    x = (x ^ (x >> 4))  & 0x100f00f00f00f00fULL;
+    x = (x ^ (x >> 8))  & 0x1f0000ff0000ffULL;
+    x = (x ^ (x >> 16)) & 0x1f00000000ffffULL;
+    x = (x ^ (x >> 32)) & 0x1fffff;
+    return x;
+}
+
+/* #####   Reference (bit loop)   ################################################### */
+
+static codestring encodeLoop(const long *location, int max_depth)
+{
+    long new_location[NDIM];
+    for (int j = 0; j < NDIM; j++)
+        new_location[j] = location[j];
+
+    codestring code = 0;
+    codestring out_bit = 1;
+    for (int i = 0; i < max_depth; i++)
+    {
+        for (int j = 0; j < NDIM; j++)
+        {
+            code |= out_bit * (new_location[j] & 1);
+
+            out_bit <<= 1;
+            new_location[j] >>= 1;
+        }
+    }
+
+    return code;
+}
+
+static void decodeLoop(codestring code, long *location, int max_depth)
+{
+    for (int j = 0; j < NDIM; j++)
+        location[j] = 0;
+
+    long out_bit = 1;
+    for (int i = 0; i < max_depth; i++)
+    {
+        for (int j = 0; j < NDIM; j++)
+        {
+            location[j] |= out_bit * (code & 1);
+            code >>= 1;
+        }
+        out_bit <<= 1;
+    }
+}
+
+/* #####   Magic bits   ############################################################# */
+
+static codestring encodeMagic(const long *location, int max_depth)
+{
+    codestring mask = axisMask(max_depth);
+    return spreadBits(location[0] & mask)
+           | (spreadBits(location[1] & mask) << 1)
+           | (spreadBits(location[2] & mask) << 2);
+}
+
+static void decodeMagic(codestring code, long *location, int max_depth)
+{
+    code &= codeMask(max_depth);
+    location[0] = compactBits(code);
+    location[1] = compactBits(code >> 1);
+    location[2] = compactBits(code >> 2);
+}
+
+/* #####   Lookup tables   ########################################################## */
+
+/*
+ * encode_table[b] spreads a byte over 24 bits; decode_table[c] gathers the three
+ * 3-bit coordinate slices packed in a 9-bit code chunk (x in bits 0-2, y 3-5, z 6-8).
+ */
+static codestring encode_table[256];
+static unsigned short decode_table[512];
+
+static bool buildTables()
+{
+    for (int b = 0; b < 256; b++)
+        encode_table[b] = spreadBits(b);
+    for (int c = 0; c < 512; c++)
+        decode_table[c] = compactBits(c) | (compactBits(c >> 1) << 3)
+                          | (compactBits(c >> 2) << 6);
+    return true;
+}
+static bool tables_built __attribute__((unused)) = buildTables();
+
+static inline codestring spreadTable(codestring x)
+{
+    return encode_table[x & 0xff]
+           | (encode_table[(x >> 8) & 0xff] << 24)
+           | (encode_table[(x >> 16) & 0x1f] << 48);
+}
+
+static codestring encodeTable(const long *location, int max_depth)
+{
+    codestring mask = axisMask(max_depth);
+    return spreadTable(location[0] & mask)
+           | (spreadTable(location[1] & mask) << 1)
+           | (spreadTable(location[2] & mask) << 2);
+}
+
+static void decodeTable(codestring code, long *location, int max_depth)
+{
+    code &= codeMask(max_depth);
+
+    long x = 0, y = 0, z = 0;
+    for (int shift = 0; code != 0; shift += 3)
+    {
+        unsigned int slices = decode_table[code & 0x1ff];
+        x |= ((long) (slices & 7)) << shift;
+        y |= ((long) ((slices >> 3) & 7)) << shift;
+        z |= ((long) (slices >> 6)) << shift;
+        code >>= 9;
+    }
+    location[0] = x;
+    location[1] = y;
+    location[2] = z;
+}
+
+/* #####   BMI2 (pdep/pext)   ####################################################### */
+
+#ifdef MORTON_X86
+#define X_BITS 0x1249249249249249ULL
+#define Y_BITS 0x2492492492492492ULL
+#define Z_BITS 0x4924924924924924ULL
+
+__attribute__((target("bmi2")))
+static codestring encodeBMI2(const long *location, int max_depth)
+{
+    codestring mask = axisMask(max_depth);
+    return _pdep_u64(location[0] & mask, X_BITS)
+           | _pdep_u64(location[1] & mask, Y_BITS)
+           | _pdep_u64(location[2] & mask, Z_BITS);
+}
+
+__attribute__((target("bmi2")))
+static void decodeBMI2(codestring code, long *location, int max_depth)
+{
+    code &= codeMask(max_depth);
+    location[0] = _pext_u64(code, X_BITS);
+    location[1] = _pext_u64(code, Y_BITS);
+    location[2] = _pext_u64(code, Z_BITS);
+}
+
+__attribute__((target("bmi2")))
+static void encodeBatchBMI2(int n, const long *locations, codestring *codes, int max_depth)
+{
+    for (int i = 0; i < n; i++)
+        codes[i] = encodeBMI2(&locations[NDIM * i], max_depth);
+}
+
+__attribute__((target("bmi2")))
+static void decodeBatchBMI2(int n, const codestring *codes, long *locations, int max_depth)
+{
+    for (int i = 0; i < n; i++)
+        decodeBMI2(codes[i], &locations[NDIM * i], max_depth);
+}
+#endif
+
+/* #####   Batch loops for the portable paths   ##################################### */
+
+template<codestring (*ENCODE)(const long *, int)>
+static void encodeBatch(int n, const long *locations, codestring *codes, int max_depth)
+{
+    for (int i = 0; i < n; i++)
+        codes[i] = ENCODE(&locations[NDIM * i], max_depth);
+}
+
+template<void (*DECODE)(codestring, long *, int)>
+static void decodeBatch(int n, const codestring *codes, long *locations, int max_depth)
+{
+    for (int i = 0; i < n; i++)
+        DECODE(codes[i], &locations[NDIM * i], max_depth);
+}
+
+/* #####   Dispatch   ############################################################### */
+
+typedef codestring (*EncodeFunction)(const long *, int);
+typedef void (*DecodeFunction)(codestring, long *, int);
+typedef void (*EncodeBatchFunction)(int, const long *, codestring *, int);
+typedef void (*DecodeBatchFunction)(int, const codestring *, long *, int);
+
+static codestring encodeResolve(const long *location, int max_depth);
+static void decodeResolve(codestring code, long *location, int max_depth);
+static void encodeBatchResolve(int n, const long *locations, codestring *codes, int max_depth);
+static void decodeBatchResolve(int n, const codestring *codes, long *locations, int max_depth);
+
+/*
+ * The function pointers start out at the resolvers, which pick a path on first use.
+ * This keeps the codec usable from static initializers in other translation units.
+ * First use may come from several pool workers at once, so the pointers are atomic
+ * (constant-initialized, and read relaxed: any path gives the same codes) and the
+ * default is chosen under call_once.
+ */
+static atomic<morton_enum> current_path(MORTON_LOOP);
+static atomic<EncodeFunction> encode_fn(encodeResolve);
+static atomic<DecodeFunction> decode_fn(decodeResolve);
+static atomic<EncodeBatchFunction> encode_batch_fn(encodeBatchResolve);
+static atomic<DecodeBatchFunction> decode_batch_fn(decodeBatchResolve);
+static once_flag default_path_flag;
+
+bool mortonHasBMI2()
+{
+#ifdef MORTON_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("bmi2");
+#else
+    return false;
+#endif
+}
+
+bool setMortonPath(morton_enum path)
+{
+    switch (path)
+    {
+    case MORTON_LOOP:
+        encode_fn = encodeLoop;
+        decode_fn = decodeLoop;
+        encode_batch_fn = encodeBatch<encodeLoop>;
+        decode_batch_fn = decodeBatch<decodeLoop>;
+        break;
+    case MORTON_MAGIC:
+        encode_fn = encodeMagic;
+        decode_fn = decodeMagic;
+        encode_batch_fn = encodeBatch<encodeMagic>;
+        decode_batch_fn = decodeBatch<decodeMagic>;
+        break;
+    case MORTON_TABLE:
+        encode_fn = encodeTable;
+        decode_fn = decodeTable;
+        encode_batch_fn = encodeBatch<encodeTable>;
+        decode_batch_fn = decodeBatch<decodeTable>;
+        break;
+    case MORTON_BMI2:
+#ifdef MORTON_X86
+        if (!mortonHasBMI2())
+            return false;
+        encode_fn = encodeBMI2;
+        decode_fn = decodeBMI2;
+        encode_batch_fn = encodeBatchBMI2;
+        decode_batch_fn = decodeBatchBMI2;
+        break;
+#else
+        return false;
+#endif
+    default:
+        return false;
+    }
+
+    current_path = path;
+    return true;
+}
+
+morton_enum getMortonPath()
+{
+    if (encode_fn.load(memory_order_relaxed) == encodeResolve)
+        encodeResolve(NULL, 0);
+    return current_path;
+}
+
+const char *mortonPathName(morton_enum path)
+{
+    switch (path)
+    {
+    case MORTON_LOOP:  return "loop";
+    case MORTON_MAGIC: return "magic";
+    case MORTON_TABLE: return "table";
+    case MORTON_BMI2:  return "bmi2";
+    }
+    return "unknown";
+}
+
+static void setDefaultPath()
+{
+    if (!setMortonPath(MORTON_BMI2))
+        setMortonPath(MORTON_MAGIC);
+}
+
+/* Only the first caller sets the default; the rest wait for it to finish */
+static void selectDefaultPath()
+{
+    call_once(default_path_flag, setDefaultPath);
+}
+
+static codestring encodeResolve(const long *location, int max_depth)
+{
+    selectDefaultPath();
+    return (location == NULL) ? 0 : encode_fn.load(memory_order_relaxed)(location, max_depth);
+}
+
+static void decodeResolve(codestring code, long *location, int max_depth)
+{
+    selectDefaultPath();
+    decode_fn.load(memory_order_relaxed)(code, location, max_depth);
+}
+
+static void encodeBatchResolve(int n, const long *locations, codestring *codes, int max_depth)
+{
+    selectDefaultPath();
+    encode_batch_fn.load(memory_order_relaxed)(n, locations, codes, max_depth);
+}
+
+static void decodeBatchResolve(int n, const codestring *codes, long *locations, int max_depth)
+{
+    selectDefaultPath();
+    decode_batch_fn.load(memory_order_relaxed)(n, codes, locations, max_depth);
+}
+
+/* #####   Exported codec   ######################################################### */
+
+codestring mortonEncode(const long *location, int max_depth)
+{
+    return encode_fn.load(memory_order_relaxed)(location, max_depth);
+}
+
+void mortonDecode(codestring code, long *location, int max_depth)
+{
+    decode_fn.load(memory_order_relaxed)(code, location, max_depth);
+}
+
+void mortonEncode(int n, const long *locations, codestring *codes, int max_depth)
+{
+    encode_batch_fn.load(memory_order_relaxed)(n, locations, codes, max_depth);
+}
+
+void mortonDecode(int n, const codestring *codes, long *locations, int max_depth)
+{
+    decode_batch_fn.load(memory_order_relaxed)(n, codes, locations, max_depth);
+}
+
+/* #####   Axis arithmetic   ######################################################## */
+
+codestring mortonAxisMask(int axis, int max_depth)
+{
+    return spreadBits(axisMask(max_depth)) << axis;
+}
+
+codestring mortonStep(int axis, long offset, int max_depth)
+{
+    return spreadBits(offset & axisMask(max_depth)) << axis;
+}
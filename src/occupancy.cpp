@@ -0,0 +1,450 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  occupancy.cpp
+ *
+ *    Description:  Compact occupancy-stream encoding of an octree and its leaves
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 06:20:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "occupancy.h"
+#include "radix_sort.h"
+#include <string.h>
+#include <stdint.h>
+#include <cmath>
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+static void write_varint(ostream &out, unsigned long long value)
+{
+    char bytes[10];
+    int n = 0;
+    do
+    {
+        bytes[n] = value & 0x7f;
+        value >>= 7;
+        if (value != 0)
+            bytes[n] |= 0x80;
+        n++;
+    } while (value != 0);
+    out.write(bytes, n);
+}
+
+static bool read_varint(istream &in, unsigned long long &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = in.get();
+        if (byte == EOF)
+            return false;
+        value |= (unsigned long long) (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void write_double(ostream &out, double value)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char bytes[8];
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (bits >> (8 * i)) & 0xff;
+    out.write(bytes, 8);
+}
+
+static bool read_double(istream &in, double &value)
+{
+    unsigned char bytes[8];
+    if (!in.read((char *) bytes, 8))
+        return false;
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++)
+        bits |= (uint64_t) bytes[i] << (8 * i);
+    memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+/* Append the low num_bits of value to a little-endian bit stream */
+static void put_bits(vector<unsigned char> &bytes, long &bit, unsigned long value, int num_bits)
+{
+    for (int b = 0; b < num_bits; b++, bit++)
+    {
+        if (bit % 8 == 0)
+            bytes.push_back(0);
+        bytes.back() |= ((value >> b) & 1) << (bit % 8);
+    }
+}
+
+/* Read num_bits (at most MAX_OFFSET_BITS) from the three bytes spanning them */
+static unsigned long get_bits(const vector<unsigned char> &bytes, long &bit, int num_bits)
+{
+    long first = bit / 8;
+    unsigned long window = 0;
+    for (int b = 0; b < 3 && first + b < (long) bytes.size(); b++)
+        window |= (unsigned long) bytes[first + b] << (8 * b);
+    window >>= bit % 8;
+    bit += num_bits;
+    return window & ((1ul << num_bits) - 1);
+}
+
+/* Lower corner and edge of the voxel with the given code */
+static void voxel_of(codestring code, const double *limits, int max_depth, double *corner,
+                     double *edge)
+{
+    long int_location[NDIM];
+    codeToLocation(code, int_location, max_depth);
+    for (int j = 0; j < NDIM; j++)
+    {
+        edge[j] = (limits[2 * j + 1] - limits[2 * j]) / (1 << max_depth);
+        corner[j] = limits[2 * j] + int_location[j] * edge[j];
+    }
+}
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  void octahedralEncode(const float[NDIM], signed char[2])
+ *  Description:  Project a unit normal onto the octahedron |x|+|y|+|z| = 1, fold the
+ *                  lower half over the upper, and keep x and y in NORMAL_STEPS steps.
+ *                  An undefined (NaN or zero) normal becomes NORMAL_UNDEFINED twice.
+ * =====================================================================================
+ */
+void octahedralEncode(const float normal[NDIM], signed char code[2])
+{
+    float sum = fabs(normal[0]) + fabs(normal[1]) + fabs(normal[2]);
+    if (!(sum > 0))
+    {
+        code[0] = code[1] = NORMAL_UNDEFINED;
+        return;
+    }
+
+    float x = normal[0] / sum, y = normal[1] / sum;
+    if (normal[2] < 0)
+    {
+        float folded_x = (1 - fabs(y)) * (x >= 0 ? 1 : -1);
+        y = (1 - fabs(x)) * (y >= 0 ? 1 : -1);
+        x = folded_x;
+    }
+    code[0] = (signed char) lround(x * NORMAL_STEPS);
+    code[1] = (signed char) lround(y * NORMAL_STEPS);
+}
+
+void octahedralDecode(const signed char code[2], float normal[NDIM])
+{
+    if (code[0] == NORMAL_UNDEFINED && code[1] == NORMAL_UNDEFINED)
+    {
+        for (int j = 0; j < NDIM; j++)
+            normal[j] = NAN;
+        return;
+    }
+
+    float x = code[0] / (float) NORMAL_STEPS, y = code[1] / (float) NORMAL_STEPS,
+          z = 1 - fabs(x) - fabs(y);
+    if (z < 0)
+    {
+        float unfolded_x = (1 - fabs(y)) * (x >= 0 ? 1 : -1);
+        y = (1 - fabs(x)) * (y >= 0 ? 1 : -1);
+        x = unfolded_x;
+    }
+
+    float length = sqrt(x * x + y * y + z * z);
+    normal[0] = x / length;
+    normal[1] = y / length;
+    normal[2] = z / length;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool writeOccupancy(ostream&, Octree&, OctreeGraph&)
+ *  Description:  Encode the leaves of the graph.  The masks of each level are derived
+ *                  from the sorted leaf codes in one pass per level, so the pointer tree
+ *                  is never walked; everything is written as it is produced.
+ * =====================================================================================
+ */
+bool writeOccupancy(ostream &out, Octree &tree, OctreeGraph &graph, int offset_bits)
+{
+    int num_leaves = graph.getNumVertices(), max_depth = tree.max_depth;
+    offset_bits = max(1, min(offset_bits, MAX_OFFSET_BITS));
+    long offset_steps = 1l << offset_bits;
+
+    vector<CodeIndex> order(num_leaves);
+    for (int i = 0; i < num_leaves; i++)
+    {
+        order[i].code = graph.getVertex(i)->getAddress();
+        order[i].index = i;
+    }
+    radixSort(order, NDIM * max_depth);
+
+    /* Normals are only worth a column if some leaf has one */
+    bool have_normals = false;
+    for (int i = 0; i < num_leaves && !have_normals; i++)
+    {
+        const float *normal = graph.getVertex(i)->getNormal();
+        have_normals = !(normal[0] == 0 && normal[1] == 0 && normal[2] == 0);
+    }
+
+    /* Header */
+    char magic[6];
+    memcpy(magic, OCCUPANCY_MAGIC, sizeof(magic));
+    out.write(magic, sizeof(magic));
+    out.put(OCCUPANCY_VERSION);
+    out.put(max_depth);
+    out.put(have_normals ? OCCUPANCY_NORMALS : 0);  // flags
+    out.put(offset_bits);
+    for (int i = 0; i < 2 * NDIM; i++)
+        write_double(out, tree.getLimits()[i]);
+    write_varint(out, num_leaves);
+
+    /* Masks, level by level: a node at depth d is the code prefix shifted down by
+     * NDIM*(max_depth-d), and its children are consecutive in code order */
+    for (int depth = 0; depth < max_depth && num_leaves > 0; depth++)
+    {
+        int child_shift = NDIM * (max_depth - depth - 1);
+        codestring node = order[0].code >> (child_shift + NDIM);
+        unsigned char mask = 0;
+
+        for (int i = 0; i < num_leaves; i++)
+        {
+            codestring child = order[i].code >> child_shift;
+            if ((child >> NDIM) != node)
+            {
+                out.put(mask);
+                node = child >> NDIM;
+                mask = 0;
+            }
+            mask |= 1 << (child & (NDIV - 1));
+        }
+        out.put(mask);
+    }
+
+    /* Leaf columns, a block at a time */
+    vector<unsigned char> offsets;
+    vector<char> normals;
+    for (int begin = 0; begin < num_leaves; begin += OCCUPANCY_BLOCK)
+    {
+        int end = min(begin + OCCUPANCY_BLOCK, num_leaves);
+        long bit = 0;
+        offsets.clear();
+        normals.resize(2 * (end - begin));
+
+        for (int i = begin; i < end; i++)
+        {
+            OctreePoint *p = graph.getVertex(order[i].index);
+            double corner[NDIM], edge[NDIM];
+            voxel_of(order[i].code, tree.getLimits(), max_depth, corner, edge);
+            for (int j = 0; j < NDIM; j++)
+            {
+                long step = floor((p->getLocation()[j] - corner[j]) / edge[j] * offset_steps);
+                put_bits(offsets, bit, max(0l, min(step, offset_steps - 1)), offset_bits);
+            }
+            octahedralEncode(p->getNormal(), (signed char *) &normals[2 * (i - begin)]);
+        }
+        out.write((const char *) offsets.data(), offsets.size());
+        if (have_normals)
+            out.write(normals.data(), normals.size());
+
+        /* Counts: runs of single-point leaves, each followed by one larger count */
+        long run = 0;
+        for (int i = begin; i < end; i++)
+        {
+            int count = graph.getVertex(order[i].index)->getNumPoints();
+            if (count == 1)
+            {
+                run++;
+                continue;
+            }
+            write_varint(out, run);
+            write_varint(out, count);
+            run = 0;
+        }
+        if (run > 0)
+            write_varint(out, run);
+    }
+
+    return out.good();
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool readOccupancy(istream&, OccupancyLeaves&)
+ *  Description:  Decode a stream into leaf arrays.  The masks are expanded level by
+ *                  level, keeping only the current level's node codes.
+ * =====================================================================================
+ */
+bool readOccupancy(istream &in, OccupancyLeaves &leaves)
+{
+    char magic[6];
+    int version, flags, offset_bits;
+    unsigned long long num_leaves;
+
+    if (!in.read(magic, sizeof(magic)) || memcmp(magic, OCCUPANCY_MAGIC, sizeof(magic)) != 0)
+    {
+        cout << "ERROR:  Not an occupancy stream.\n";
+        return false;
+    }
+    version = in.get();
+    leaves.max_depth = in.get();
+    flags = in.get();
+    offset_bits = in.get();
+    if (version != OCCUPANCY_VERSION)
+    {
+        cout << "ERROR:  Unsupported occupancy stream version " << version << ".\n";
+        return false;
+    }
+    if (offset_bits < 1 || offset_bits > MAX_OFFSET_BITS)
+    {
+        cout << "ERROR:  Bad occupancy offset width " << offset_bits << ".\n";
+        return false;
+    }
+    if (leaves.max_depth < 0 || leaves.max_depth > MORTON_MAX_DEPTH)
+    {
+        cout << "ERROR:  Bad occupancy depth " << leaves.max_depth << ".\n";
+        return false;
+    }
+    if (flags < 0 || (flags & ~OCCUPANCY_NORMALS) != 0)
+    {
+        cout << "ERROR:  Unknown occupancy flags " << flags << ".\n";
+        return false;
+    }
+    for (int i = 0; i < 2 * NDIM; i++)
+        read_double(in, leaves.limits[i]);
+    if (!read_varint(in, num_leaves) || !in.good())
+    {
+        cout << "ERROR:  Truncated occupancy header.\n";
+        return false;
+    }
+
+    /* Expand the masks, keeping them for insertMasks.  Each level has one mask per node
+     * of the level above, so a level is read in one piece */
+    vector<codestring> &codes = leaves.codes, next;
+    vector<unsigned char> &masks = leaves.masks;
+    codes.assign(num_leaves > 0 ? 1 : 0, 0);
+    masks.clear();
+    for (int depth = 0; depth < leaves.max_depth && !codes.empty(); depth++)
+    {
+        long first = masks.size();
+        masks.resize(first + codes.size());
+        if (!in.read((char *) &masks[first], codes.size()))
+        {
+            cout << "ERROR:  Truncated occupancy masks.\n";
+            return false;
+        }
+
+        next.clear();
+        for (unsigned int i = 0; i < codes.size(); i++)
+            for (int octant = 0; octant < NDIV; octant++)
+                if (masks[first + i] & (1 << octant))
+                    next.push_back((codes[i] << NDIM) | octant);
+        codes.swap(next);
+    }
+    if (codes.size() != num_leaves)
+    {
+        cout << "ERROR:  Occupancy masks give " << codes.size() << " leaves, not "
+             << num_leaves << ".\n";
+        return false;
+    }
+
+    /* Leaf columns */
+    leaves.locations.resize(NDIM * num_leaves);
+    leaves.normals.assign(NDIM * num_leaves, 0);
+    leaves.num_points.resize(num_leaves);
+
+    vector<unsigned char> offsets;
+    vector<signed char> normals;
+    for (int begin = 0; begin < (int) num_leaves; begin += OCCUPANCY_BLOCK)
+    {
+        int end = min(begin + OCCUPANCY_BLOCK, (int) num_leaves);
+        long bit = 0;
+        offsets.resize(((long) NDIM * offset_bits * (end - begin) + 7) / 8);
+        in.read((char *) offsets.data(), offsets.size());
+        if (flags & OCCUPANCY_NORMALS)
+        {
+            normals.resize(2 * (end - begin));
+            in.read((char *) normals.data(), normals.size());
+        }
+
+        for (int i = begin; i < end; i++)
+        {
+            double corner[NDIM], edge[NDIM];
+            voxel_of(codes[i], leaves.limits, leaves.max_depth, corner, edge);
+            for (int j = 0; j < NDIM; j++)
+                leaves.locations[NDIM * i + j] =
+                    corner[j] + (get_bits(offsets, bit, offset_bits) + 0.5) * edge[j]
+                                / (1l << offset_bits);
+            if (flags & OCCUPANCY_NORMALS)
+                octahedralDecode(&normals[2 * (i - begin)], &leaves.normals[NDIM * i]);
+        }
+
+        for (int i = begin; i < end;)
+        {
+            unsigned long long run, count;
+            if (!read_varint(in, run) || run > (unsigned long long) (end - i))
+            {
+                cout << "ERROR:  Corrupt occupancy point counts.\n";
+                return false;
+            }
+            for (; run > 0; run--)
+                leaves.num_points[i++] = 1;
+            if (i < end)
+            {
+                if (!read_varint(in, count))
+                {
+                    cout << "ERROR:  Corrupt occupancy point counts.\n";
+                    return false;
+                }
+                leaves.num_points[i++] = count;
+            }
+        }
+    }
+
+    if (!in)
+    {
+        cout << "ERROR:  Truncated occupancy leaves.\n";
+        return false;
+    }
+    return true;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool readOccupancy(istream&, Octree&, OctreeGraph&)
+ *  Description:  Decode a stream into a tree of the same depth, then link the edges
+ *                  once.  An empty tree is built level by level from the masks
+ *                  (insertMasks); otherwise the leaves are merged in by code.
+ * =====================================================================================
+ */
+bool readOccupancy(istream &in, Octree &tree, OctreeGraph &graph)
+{
+    OccupancyLeaves leaves;
+    if (!readOccupancy(in, leaves))
+        return false;
+    if (leaves.max_depth != tree.max_depth)
+    {
+        cout << "ERROR:  Stream has depth " << leaves.max_depth << ", tree has "
+             << tree.max_depth << ".\n";
+        return false;
+    }
+
+    tree.setLimits(leaves.limits);
+    int first_new = graph.getNumVertices();
+    if (tree.insertMasks(leaves.masks.data(), leaves.masks.size(),
+                         leaves.locations.data(), leaves.normals.data(),
+                         leaves.num_points.data(), leaves.codes.size(), graph) < 0)
+        tree.insertLeaves(leaves.codes.data(), leaves.locations.data(),
+                          leaves.normals.data(), leaves.num_points.data(),
+                          leaves.codes.size(), graph);
+    graph.updateEdges(first_new);
+    return true;
+}
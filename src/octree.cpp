@@ -16,6 +16,7 @@
  * =====================================================================================
  */
 #include "octree.h"
+#include "thread_pool.h"
 #include <float.h>
 #include <iomanip>
 using namespace std;
@@ -25,11 +26,12 @@ using namespace std;
 /*
  *--------------------------------------------------------------------------------------
  *       Class:  Octree
- *      Method:  Octree(const float*, int)
- * Description:  Construct the root of a new Octree
+ *      Method:  Octree(const float*, int, bool)
+ * Description:  Construct the root of a new Octree.  With use_arena, every node, child
+ *                  array and leaf of the tree comes from pools owned by the root.
  *--------------------------------------------------------------------------------------
  */
-Octree::Octree(const double *new_limits, int new_max_depth)
+Octree::Octree(const double *new_limits, int new_max_depth, bool use_arena)
 {
 
     /* Position on the tree */
@@ -45,6 +47,9 @@ Octree::Octree(const double *new_limits, int new_max_depth)
     for (int i = 0; i < 2 * NDIM; i++)
         limits[i] = new_limits[i];
 
+    /* Storage */
+    storage = use_arena ? new OctreeStorage : NULL;
+
     /* p d */
     num_descendants = 0;
     children = new Octree*[NDIV];
@@ -76,6 +81,7 @@ Octree::Octree(const PointIter new_begin, const PointIter new_end, Octree *new_p
     depth = parent->depth + 1;
     depth_bit = (parent->depth_bit) >> NDIM;
     index = new_points.size();
+    storage = parent->storage;
 
     /* Limits */
     codestring test_bit = parent->depth_bit;
@@ -96,7 +102,10 @@ Octree::Octree(const PointIter new_begin, const PointIter new_end, Octree *new_p
     // Non-leaf nodes
     else
     {
-        children = new Octree*[NDIV];
+        if (storage != NULL)
+            children = (Octree **) storage->local().child_arrays.allocate(NDIV * sizeof(Octree *));
+        else
+            children = new Octree*[NDIV];
         for (int i = 0; i < NDIV; i++)
             children[i] = NULL;
     }
@@ -116,6 +125,17 @@ Octree::Octree(const PointIter new_begin, const PointIter new_end, Octree *new_p
  */
 Octree::~Octree()
 {
+    /* Pooled trees are released in bulk through the root */
+    if (storage != NULL)
+    {
+        if (parent == NULL)
+        {
+            delete[] children;
+            delete storage;
+        }
+        return;
+    }
+
     if (children != NULL)
     {
         for (int i = 0; i < NDIV; i++)
@@ -124,8 +144,8 @@ Octree::~Octree()
                 delete children[i];
             children[i] = NULL;
         }
-        children = NULL;
         delete[] children;
+        children = NULL;
     }
 
     if (data != NULL)
@@ -134,6 +154,38 @@ Octree::~Octree()
     }
 }
 
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  Octree* newChild(const PointIter, const PointIter, codestring,
+ *                  vector<OctreePoint*>&)
+ * Description:  Construct a child tree, from the tree's pools if it has them
+ *--------------------------------------------------------------------------------------
+ */
+Octree *Octree::newChild(const PointIter new_begin, const PointIter new_end,
+                         codestring new_address, vector<OctreePoint*>& new_points)
+{
+    if (storage != NULL)
+        return storage->local().nodes.create(new_begin, new_end, this, new_address, new_points);
+    else
+        return new Octree(new_begin, new_end, this, new_address, new_points);
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  OctreePoint* newLeaf(const PointIter, const PointIter)
+ * Description:  Construct the data point of a leaf, from the tree's pools if it has them
+ *--------------------------------------------------------------------------------------
+ */
+OctreePoint *Octree::newLeaf(const PointIter new_begin, const PointIter new_end)
+{
+    if (storage != NULL)
+        return storage->local().leaves.create(new_begin, new_end, this);
+    else
+        return new OctreePoint(new_begin, new_end, this);
+}
+
 /* #####   Initializers   ########################################################### */
 
 /*
@@ -165,6 +217,30 @@ void findLimits(const double* points, int num_points, double* limits){
 void Octree::addPoints(const double *new_points, const float *new_normals,
                        int num_points, OctreeGraph &graph)
 {
+    PROFILE_SCOPE("addPoints");
+    int first_new = graph.getNumVertices();
+    int numValid = insertPoints(new_points, new_normals, num_points, graph);
+    cout << "Added " << numValid << " / " << num_points << " good points ";
+
+    /* 4. Link the new leaves to their neighborhoods */
+    graph.updateEdges(first_new);
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  int insertPoints(const double*, const float*, int, OctreeGraph&)
+ * Description:  Steps 1-3 of addPoints: file the points into leaves, adding new leaves
+ *                  to the graph without linking them.  Returns the number of points
+ *                  that fell inside the limits.  Call graph.updateEdges (or
+ *                  computeEdges) once the last batch is in.
+ *--------------------------------------------------------------------------------------
+ */
+int Octree::insertPoints(const double *new_points, const float *new_normals,
+                         int num_points, OctreeGraph &graph)
+{
+    PROFILE_SCOPE("insertPoints");
+    PROFILE_COUNT("points_ingested", num_points);
     if(isZero(limits, 2*NDIM))
         findLimits(new_points, num_points, limits);
 
@@ -190,18 +266,170 @@ void Octree::addPoints(const double *new_points, const float *new_normals,
             new_codes.push_back(new_point);
         }
     }
-    cout << "Added " << numValid << " / " << num_points << " good points ";
     //for(int i=0; i<new_codes.size(); i++)
     //    cout << new_codes[i] << endl;
 
     /* 2. Sort the vector */
-    sort(new_codes.begin(), new_codes.end());
+    sortPoints(new_codes, max_depth);
 
 
     /* 3. Add points */
-    findPoints(new_codes.begin(), new_codes.end(), graph.getVertices(), true);
+    fileSorted(new_codes, graph);
+
+    return numValid;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  int insertLeaves(const codestring*, const double*, const float*,
+ *                                const int*, int, OctreeGraph&)
+ * Description:  Add ready-made leaves: codes (ascending) with their averaged location,
+ *                  normal and point count.  Nothing is encoded or sorted.  A code that
+ *                  already has a leaf is merged into it as a single point.  Like
+ *                  insertPoints, the new leaves are left unlinked.  Returns the number
+ *                  of leaves created.
+ *--------------------------------------------------------------------------------------
+ */
+int Octree::insertLeaves(const codestring *codes, const double *locations,
+                         const float *normals, const int *num_points, int num_leaves,
+                         OctreeGraph &graph)
+{
+    PointBuffer new_codes(num_leaves);
+    for (int i = 0; i < num_leaves; i++)
+    {
+        CodedPoint &p = new_codes[i];
+        p.code = codes[i];
+        codeToLocation(codes[i], p.int_location, max_depth);
+        for (int j = 0; j < NDIM; j++)
+        {
+            p.location[j] = locations[NDIM * i + j];
+            p.normal[j] = normals[NDIM * i + j];
+        }
+        p.good_point = true;
+    }
+
+    int first_new = graph.getNumVertices();
+    fileSorted(new_codes, graph);
 
-    graph.computeEdges();
+    /* New leaves come out in code order; each took one point, give it its count */
+    vector<OctreePoint *> &vertices = graph.getVertices();
+    int k = 0;
+    for (unsigned int v = first_new; v < vertices.size(); v++)
+    {
+        while (k < num_leaves && codes[k] < vertices[v]->address)
+            k++;
+        if (k < num_leaves && codes[k] == vertices[v]->address)
+            vertices[v]->num_points = num_points[k];
+    }
+    return vertices.size() - first_new;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  int insertMasks(const unsigned char*, long, const double*, const float*,
+ *                               const int*, int, OctreeGraph&)
+ * Description:  Build an empty tree from occupancy masks: one byte per internal node,
+ *                  breadth first, children in code order, bit i set if octant i is
+ *                  occupied.  Each level's nodes are created from the masks of the
+ *                  level above, and the leaves are attached in code order with their
+ *                  averaged location, normal and point count, so nothing is sorted or
+ *                  searched.  Like insertLeaves, the new leaves are left unlinked.
+ *                  Returns the number of leaves created, or -1 (leaving the tree
+ *                  untouched) if the tree is not empty or the masks do not describe
+ *                  exactly num_leaves leaves.
+ *--------------------------------------------------------------------------------------
+ */
+int Octree::insertMasks(const unsigned char *masks, long num_masks,
+                        const double *locations, const float *normals,
+                        const int *num_points, int num_leaves, OctreeGraph &graph)
+{
+    PROFILE_SCOPE("insertMasks");
+    if (depth != 0 || max_depth < 1)
+        return -1;
+    for (int i = 0; i < NDIV; i++)
+        if (children[i] != NULL)
+            return -1;
+
+    /* Check the masks first: each level has as many nodes as the level above has bits */
+    long level_size = 1, m = 0;
+    for (int d = 0; d < max_depth; d++)
+    {
+        if (num_masks - m < level_size)
+            return -1;
+        long next_size = 0;
+        for (long i = 0; i < level_size; i++, m++)
+            for (int octant = 0; octant < NDIV; octant++)
+                next_size += (masks[m] >> octant) & 1;
+        level_size = next_size;
+    }
+    if (m != num_masks || level_size != num_leaves || num_leaves == 0)
+        return -1;
+
+    /* Internal levels; levels[d] holds the nodes at depth d */
+    vector<OctreePoint *> &vertices = graph.getVertices();
+    int first_new = vertices.size();
+    PointBuffer leaf(1), none;
+    vector<vector<Octree *> > levels(max_depth);
+    levels[0].push_back(this);
+    m = 0;
+    for (int d = 0; d + 1 < max_depth; d++)
+        for (unsigned int i = 0; i < levels[d].size(); i++, m++)
+        {
+            Octree *node = levels[d][i];
+            for (int octant = 0; octant < NDIV; octant++)
+                if (masks[m] & (1 << octant))
+                {
+                    codestring child_address = node->address + octant * node->depth_bit;
+                    node->children[octant] =
+                        node->newChild(none.begin(), none.end(), child_address, vertices);
+                    levels[d + 1].push_back(node->children[octant]);
+                }
+        }
+
+    /* Leaves, in code order; each node's constructor files its one point */
+    CodedPoint &p = leaf[0];
+    int k = 0;
+    for (unsigned int i = 0; i < levels[max_depth - 1].size(); i++, m++)
+    {
+        Octree *node = levels[max_depth - 1][i];
+        for (int octant = 0; octant < NDIV; octant++)
+            if (masks[m] & (1 << octant))
+            {
+                for (int j = 0; j < NDIM; j++)
+                {
+                    p.location[j] = locations[NDIM * k + j];
+                    p.normal[j] = normals[NDIM * k + j];
+                }
+                node->children[octant] = node->newChild(
+                    leaf.begin(), leaf.end(), node->address + octant * node->depth_bit,
+                    vertices);
+                vertices.back()->num_points = num_points[k++];
+                node->num_descendants++;
+            }
+    }
+
+    /* Every node takes credit for the leaves below it, as findPoints gives it */
+    for (int d = max_depth - 1; d > 0; d--)
+        for (unsigned int i = 0; i < levels[d].size(); i++)
+            levels[d][i]->parent->num_descendants += levels[d][i]->num_descendants;
+
+    PROFILE_COUNT("leaves_created", vertices.size() - first_new);
+    return vertices.size() - first_new;
+}
+
+/* File sorted points into the tree, on NUM_THREADS threads if there are several */
+void Octree::fileSorted(PointBuffer &new_codes, OctreeGraph &graph)
+{
+    PROFILE_SCOPE("findPoints");
+    PROFILE_ONLY(int first_new = graph.getNumVertices());
+    if (NUM_THREADS > 1)
+        findPointsParallel(new_codes.begin(), new_codes.end(), graph.getVertices(),
+                           NUM_THREADS, SPLIT_DEPTH);
+    else
+        findPoints(new_codes.begin(), new_codes.end(), graph.getVertices(), true);
+    PROFILE_COUNT("leaves_created", graph.getNumVertices() - first_new);
 }
 
 /*
@@ -231,7 +459,7 @@ void Octree::findPoints(PointIter begin, const PointIter end,
         if(adding){
             if (data == NULL)
             {
-                data = new OctreePoint(begin, end, this);
+                data = newLeaf(begin, end);
                 new_points.push_back(data);
             }
             else
@@ -268,13 +496,7 @@ void Octree::findPoints(PointIter begin, const PointIter end,
                  << "-" << new_address-1 << ".\n";
             */
 
-            if (children[i] == NULL){
-                if(adding)
-                    children[i] = new Octree(begin, new_end, this, 
-                        new_address - depth_bit, new_points);
-            }
-            else
-                children[i]->findPoints(begin, new_end, new_points, adding);
+            fileChild(i, begin, new_end, new_points, adding);
         }
         /* set up for the next child */
         begin = new_end;
@@ -284,6 +506,180 @@ void Octree::findPoints(PointIter begin, const PointIter end,
         num_descendants += (new_points.size() - old_count);
 }
 
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void fileChild(int, PointIter, const PointIter, vector<OctreePoint*>&,
+ *                  bool)
+ * Description:  File a sorted run of points belonging to child i
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::fileChild(int i, PointIter begin, const PointIter end,
+    vector<OctreePoint*>& new_points, bool adding){
+
+    if (children[i] == NULL){
+        if(adding)
+            children[i] = newChild(begin, end, address + i * depth_bit, new_points);
+    }
+    else
+        children[i]->findPoints(begin, end, new_points, adding);
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void findCodes(const codestring*, const codestring*,
+ *                  vector<OctreePoint*>&)
+ * Description:  The existing leaves at a sorted run of codes, in code order.  Like
+ *                  findPoints without adding, for bare codes.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::findCodes(const codestring *begin, const codestring *end,
+    vector<OctreePoint*>& found){
+
+    if (depth == max_depth)
+    {
+        if (data != NULL)
+            found.push_back(data);
+        return;
+    }
+
+    codestring new_address = address;
+    const codestring *new_end = begin;
+    for (int i = 0; i < NDIV && begin != end; i++)
+    {
+        new_address += depth_bit;
+        while ((new_end != end) && *new_end < new_address)
+            new_end++;
+
+        if (new_end != begin && children[i] != NULL)
+            children[i]->findCodes(begin, new_end, found);
+        begin = new_end;
+    }
+}
+
+/*
+ * One independent piece of a parallel build: the points of child 'child' of 'parent',
+ * and the vertices that filing them creates.
+ */
+struct Octree::BuildTask
+{
+    Octree *parent;
+    int child;
+    PointIter begin, end;
+    vector<OctreePoint*> points;
+};
+
+/* A node above the split, and the tasks [first_task, last_task) below it */
+struct Octree::BuildSpan
+{
+    Octree *node;
+    int first_task, last_task;
+};
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void findPointsParallel(PointIter, const PointIter,
+ *                  vector<OctreePoint*>&, int, int)
+ * Description:  Add a sorted run of points, building the subtrees below split_depth
+ *                  concurrently.  Vertices come out in the same order, with the same
+ *                  indices, as from a serial findPoints.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::findPointsParallel(PointIter begin, const PointIter end,
+    vector<OctreePoint*>& new_points, int num_threads, int split_depth){
+
+    if (depth == max_depth || split_depth <= depth){
+        findPoints(begin, end, new_points, true);
+        return;
+    }
+
+    ThreadPool &pool = getThreadPool(num_threads);
+    if (storage != NULL)
+        storage->reserveShards(pool.getNumThreads());
+
+    /* 1. Walk the levels above the split, collecting one task per occupied child */
+    vector<BuildTask> tasks;
+    vector<BuildSpan> upper;
+    collectTasks(begin, end, split_depth, tasks, upper);
+
+    /* 2. Build the subtrees, each into its own vertex list */
+    pool.run(tasks.size(), [&tasks](int t){
+        BuildTask &task = tasks[t];
+        task.parent->fileChild(task.child, task.begin, task.end, task.points, true);
+    });
+
+    /* 3. Concatenate the lists in code order, renumbering to global indices */
+    vector<int> first_vertex(tasks.size() + 1);
+    for (unsigned int t = 0; t < tasks.size(); t++){
+        int base = new_points.size();
+        first_vertex[t] = base;
+        for (unsigned int k = 0; k < tasks[t].points.size(); k++){
+            OctreePoint *p = tasks[t].points[k];
+            p->index += base;
+            p->home->index += base;
+            new_points.push_back(p);
+        }
+    }
+    first_vertex[tasks.size()] = new_points.size();
+
+    /* 4. Credit the nodes above the split with the vertices created below them */
+    for (unsigned int u = 0; u < upper.size(); u++)
+        upper[u].node->num_descendants += first_vertex[upper[u].last_task]
+                                          - first_vertex[upper[u].first_task];
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void collectTasks(PointIter, const PointIter, int, vector<BuildTask>&,
+ *                  vector<BuildSpan>&)
+ * Description:  Partition a sorted run down to split_depth, creating the (empty) nodes
+ *                  above it, and note which tasks fall below each of those nodes
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::collectTasks(PointIter begin, const PointIter end, int split_depth,
+    vector<BuildTask>& tasks, vector<BuildSpan>& upper){
+
+    int span = upper.size();
+    upper.push_back(BuildSpan());
+    upper[span].node = this;
+    upper[span].first_task = tasks.size();
+
+    vector<OctreePoint*> no_points;
+    codestring new_address = address;
+    PointIter new_end = begin;
+    for (int i = 0; i < NDIV; i++)
+    {
+        new_address += depth_bit;
+        while ((new_end != end) && new_end->code < new_address)
+            new_end++;
+
+        if (new_end != begin)
+        {
+            if (depth + 1 >= split_depth || depth + 1 == max_depth)
+            {
+                BuildTask task;
+                task.parent = this;
+                task.child = i;
+                task.begin = begin;
+                task.end = new_end;
+                tasks.push_back(task);
+            }
+            else
+            {
+                if (children[i] == NULL)
+                    children[i] = newChild(begin, begin, new_address - depth_bit, no_points);
+                children[i]->collectTasks(begin, new_end, split_depth, tasks, upper);
+            }
+        }
+        begin = new_end;
+    }
+
+    upper[span].last_task = tasks.size();
+}
+
 /*
  *--------------------------------------------------------------------------------------
  *       Class:  Octree
@@ -319,8 +715,76 @@ OctreePoint* Octree::findAddress(codestring address){
         return pv[0];
 }
 
+/* #####   Accessors   ############################################################## */
+
+/* Bytes obtained for, and occupied by, the tree's pools (zero for heap-built trees) */
+size_t Octree::bytesReserved() const
+{
+    return (storage == NULL) ? 0 : storage->bytesReserved();
+}
+
+size_t Octree::bytesUsed() const
+{
+    return (storage == NULL) ? 0 : storage->bytesUsed();
+}
+
+/* #####   OCTREE_STORAGE  -  MEMBER FUNCTION DEFINITIONS   ######################### */
+
+OctreeStorage::OctreeStorage()
+{
+    reserveShards(1);
+}
+
+OctreeStorage::~OctreeStorage()
+{
+    for (unsigned int i = 0; i < shards.size(); i++)
+        delete shards[i];
+}
+
+/* Must be called before any thread beyond the first allocates from this storage */
+void OctreeStorage::reserveShards(int num_shards)
+{
+    while ((int) shards.size() < num_shards)
+        shards.push_back(new OctreePools);
+}
+
+OctreePools &OctreeStorage::local()
+{
+    return *shards[ThreadPool::currentWorker()];
+}
+
+size_t OctreeStorage::bytesReserved() const
+{
+    size_t total = 0;
+    for (unsigned int i = 0; i < shards.size(); i++)
+        total += shards[i]->nodes.bytesReserved() + shards[i]->leaves.bytesReserved()
+                 + shards[i]->child_arrays.bytesReserved();
+    return total;
+}
+
+size_t OctreeStorage::bytesUsed() const
+{
+    size_t total = 0;
+    for (unsigned int i = 0; i < shards.size(); i++)
+        total += shards[i]->nodes.bytesUsed() + shards[i]->leaves.bytesUsed()
+                 + shards[i]->child_arrays.bytesUsed();
+    return total;
+}
+
 /* #####   I/O   #################################################################### */
 
+/* Set the volume of an empty root (the limits of existing nodes are not revisited) */
+void Octree::setLimits(const double *new_limits)
+{
+    for (int i = 0; i < 2 * NDIM; i++)
+        limits[i] = new_limits[i];
+}
+
+const double *Octree::getLimits() const
+{
+    return limits;
+}
+
 /*
  *--------------------------------------------------------------------------------------
  *       Class:  Octree
@@ -16,6 +16,10 @@
  * =====================================================================================
  */
 #include "octree.h"
+#include "thread_pool.h"
+#include "morton.h"
+#include "radix_sort.h"
+#include "stencil.h"
 #include <queue>
 #include <cmath>
 
@@ -55,14 +59,32 @@ ostream &operator<<(ostream &out, const OctreeEdge &edge)
  *--------------------------------------------------------------------------------------
  *       Class:  OctreeGraph
  *      Method:  OctreeGraph()
- * Description:  Initialize the graph (at present, trivially)
+ * Description:  Initialize the graph; with use_arena, edges come from a slab pool, and
+ *                  with use_slots, the edge builders also fill the stencil slots
  *--------------------------------------------------------------------------------------
  */
-OctreeGraph::OctreeGraph()
+OctreeGraph::OctreeGraph(bool new_use_arena, bool new_use_slots)
 {
+    use_arena = new_use_arena;
+    use_slots = new_use_slots;
+    edges_released = false;
     frame_indices.push_back(vertices.size());
 }
 
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  ~OctreeGraph()
+ * Description:  Release the edges (the vertices belong to the tree)
+ *--------------------------------------------------------------------------------------
+ */
+OctreeGraph::~OctreeGraph()
+{
+    if (!use_arena)
+        for (unsigned int i = 0; i < edges.size(); i++)
+            delete edges[i];
+}
+
 /*
  *--------------------------------------------------------------------------------------
  *       Class:  OctreeGraph
@@ -84,7 +106,10 @@ void OctreeGraph::addPoint(OctreePoint *p)
  */
 void OctreeGraph::addEdge(OctreePoint *p1, OctreePoint *p2)
 {
-    edges.push_back(new OctreeEdge(p1, p2));
+    if (use_arena)
+        edges.push_back(edge_pool.create(p1, p2));
+    else
+        edges.push_back(new OctreeEdge(p1, p2));
 }
 
 
@@ -133,9 +158,31 @@ void OctreeGraph::fixNormals(OctreePoint *start, vector<float> &total_turn)
 
 void OctreeGraph::computeNormals()
 {
-    TIC("Computing normals: ")    
-    for (unsigned int i = 0; i < vertices.size(); i++)
-        vertices[i]->computeNormal();
+    PROFILE_SCOPE("computeNormals");
+    TIC("Computing normals: ")
+    /* Covariances are solved in blocks, so the eigensolver can run across lanes.
+     * Blocks are independent (a vertex only reads its neighbors' locations), so
+     * they are also the unit of work handed to the pool. */
+    const int BLOCK = 1024;
+    int num_blocks = (vertices.size() + BLOCK - 1) / BLOCK;
+
+    getThreadPool(NUM_THREADS).run(num_blocks, [&](int b)
+    {
+        double covs[BLOCK][NDIM][NDIM], evals[BLOCK][NDIM], evecs[BLOCK][NDIM][NDIM];
+        int begin = b * BLOCK,
+            block_size = min(BLOCK, (int) vertices.size() - begin);
+
+        for (int k = 0; k < block_size; k++)
+        {
+            OctreePoint *p = vertices[begin + k];
+            p->computeCovariance(covs[k], COVAR_SIGMA / ((double)(1 << p->depth)));
+        }
+
+        symmetricEigenBatch(block_size, covs, evals, evecs);
+
+        for (int k = 0; k < block_size; k++)
+            vertices[begin + k]->setNormal(evals[k], evecs[k]);
+    });
     TOC
 
     return;
@@ -151,27 +198,391 @@ void OctreeGraph::computeNormals()
 
 }
 
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void computeNormals(Octree&, double)
+ * Description:  Normals at a fixed metric scale: the covariance of each vertex is taken
+ *                  over the leaves of the tree within radius of its location, weighted
+ *                  with sigma = COVAR_SIGMA * radius, rather than over its stencil
+ *                  neighbors.  The edges are not used, and need not exist.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreeGraph::computeNormals(Octree &tree, double radius)
+{
+    PROFILE_SCOPE("computeNormals");
+    TIC("Computing normals (radius " << radius << "): ")
+    const int BLOCK = 1024;
+    int num_blocks = (vertices.size() + BLOCK - 1) / BLOCK;
+
+    getThreadPool(NUM_THREADS).run(num_blocks, [&](int b)
+    {
+        double covs[BLOCK][NDIM][NDIM], evals[BLOCK][NDIM], evecs[BLOCK][NDIM][NDIM];
+        int begin = b * BLOCK,
+            block_size = min(BLOCK, (int) vertices.size() - begin);
+        vector<OctreePoint *> around;
+
+        for (int k = 0; k < block_size; k++)
+        {
+            OctreePoint *p = vertices[begin + k];
+            tree.radiusSearch(p->location, radius, around);
+            around.erase(remove(around.begin(), around.end(), p), around.end());
+            p->computeCovariance(around, covs[k], COVAR_SIGMA * radius);
+        }
+
+        symmetricEigenBatch(block_size, covs, evals, evecs);
+
+        for (int k = 0; k < block_size; k++)
+            vertices[begin + k]->setNormal(evals[k], evecs[k]);
+    });
+    TOC
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void computeEdges()
+ * Description:  Rebuild every neighbor list and the whole edge store.  The searches
+ *                  run on NUM_THREADS threads, each filling the lists of its own
+ *                  vertices; the lists are then merged into edges in vertex order, so
+ *                  the result does not depend on the number of threads.  With
+ *                  EDGE_SWEEP set, the lists come from one join over all the leaves
+ *                  instead (the same lists).
+ *--------------------------------------------------------------------------------------
+ */
 void OctreeGraph::computeEdges()
 {
-    // bool good_vertex = true;
+    PROFILE_SCOPE("computeEdges");
+    clearEdges();
+    clearAdjacency();
+    edges_released = false;
+    if (use_slots)
+        vector<int>((size_t) NNEI * vertices.size(), -1).swap(slots);
+    if (EDGE_SWEEP)
+        sweepNeighbors();
+    else
+        searchNeighbors(0);
+
     for (unsigned int i = 0; i < vertices.size(); i++)
     {
-        // cout << i << ". (";
-        // for (int j = 0; j < NDIM; j++)
-        // {
-        //     cout << vertices[i]->home->limits[2 * j]
-        //          << "<" << vertices[i]->location[j]
-        //          << "<" << vertices[i]->home->limits[2 * j + 1] << "\t";
-        //     good_vertex = good_vertex && ((vertices[i]->home->limits[2 * j] <= vertices[i]->location[j])
-        //                                   && (vertices[i]->home->limits[2 * j + 1] >= vertices[i]->location[j]));            
-        // }
-        // cout << ") ";
-        // if (good_vertex) cout << " X";
-        // cout << endl;
-        vertices[i]->findNeighbors(*this);
+        OctreePoint *p = vertices[i];
+        for (unsigned int j = 0; j < p->neighbors.size(); j++)
+            addEdge(p, p->neighbors[j]);
+    }
+    PROFILE_COUNT("edges_emitted", edges.size());
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void updateEdges(int)
+ * Description:  Bring the edges up to date after vertices [first_new, end) were added.
+ *                  Only the new vertices search the tree; an existing vertex can only
+ *                  gain new neighbors, and (the stencil being symmetric) those are
+ *                  exactly the new vertices that found it.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreeGraph::updateEdges(int first_new)
+{
+    /* The old vertices no longer know their neighbors; start over */
+    if (edges_released)
+    {
+        computeEdges();
+        return;
+    }
+    PROFILE_SCOPE("updateEdges");
+    clearAdjacency();
+
+    PROFILE_ONLY(int first_edge = edges.size());
+    if (use_slots)
+        slots.resize((size_t) NNEI * vertices.size(), -1);
+    searchNeighbors(first_new);
+
+    for (unsigned int i = first_new; i < vertices.size(); i++)
+    {
+        OctreePoint *p = vertices[i];
+        for (unsigned int j = 0; j < p->neighbors.size(); j++)
+            addEdge(p, p->neighbors[j]);
+
+        for (unsigned int j = 0; j < p->neighbors.size(); j++)
+        {
+            OctreePoint *q = p->neighbors[j];
+            if (q->index >= first_new)
+                continue;
 
+            /* Keep q's list in the order findNeighbors leaves it */
+            vector<OctreePoint *>::iterator slot =
+                lower_bound(q->neighbors.begin(), q->neighbors.end(), p, index_less);
+            q->neighbors.insert(slot, p);
+            addEdge(q, p);
+
+            if (use_slots)
+            {
+                int relative_coords[NDIM];
+                for (int axis = 0; axis < NDIM; axis++)
+                    relative_coords[axis] = p->home->int_location[axis]
+                                            - q->home->int_location[axis];
+                slots[(size_t) NNEI * q->index + stencilSlot(relative_coords)] = i;
+            }
+        }
     }
+    PROFILE_COUNT("edges_emitted", edges.size() - first_edge);
+}
+
+/* Refill the neighbor lists (and slots) of vertices [first, end) from the tree, in
+ * parallel */
+void OctreeGraph::searchNeighbors(int first)
+{
+    const int BLOCK = 1024;
+    int num_blocks = (vertices.size() - first + BLOCK - 1) / BLOCK;
+
+    getThreadPool(NUM_THREADS).run(num_blocks, [&](int b)
+    {
+        int begin = first + b * BLOCK,
+            end = min(begin + BLOCK, (int) vertices.size());
+        for (int i = begin; i < end; i++)
+        {
+            vertices[i]->findNeighbors();
+            if (use_slots)
+                fillSlots(i);
+        }
+    });
+}
 
+/* Place each neighbor of vertex i in the slot of its offset (the row starts empty) */
+void OctreeGraph::fillSlots(int i)
+{
+    OctreePoint *p = vertices[i];
+    int *row = &slots[(size_t) NNEI * i];
+    for (unsigned int n = 0; n < p->neighbors.size(); n++)
+    {
+        OctreePoint *q = p->neighbors[n];
+        int relative_coords[NDIM];
+        for (int j = 0; j < NDIM; j++)
+            relative_coords[j] = q->home->int_location[j] - p->home->int_location[j];
+        row[stencilSlot(relative_coords)] = q->index;
+    }
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void sweepNeighbors()
+ * Description:  Refill every neighbor list without touching the tree.  The leaf codes
+ *                  are sorted once; for each offset in the upper half of the stencil,
+ *                  every code is shifted by dilated addition, the shifted stream sorted,
+ *                  and merge-joined against the leaves (offsets as wide as the grid are
+ *                  skipped: they reach nothing).  Each match is an edge and its
+ *                  mirror image (the lower half of the stencil), written to one flat
+ *                  array, and to the slots if they are kept.  Offsets are independent,
+ *                  so they are spread over the pool.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreeGraph::sweepNeighbors()
+{
+    int num_vertices = vertices.size();
+    if (num_vertices == 0)
+        return;
+    int max_depth = vertices[0]->home->max_depth;
+
+    vector<CodeIndex> leaves(num_vertices);
+    for (int i = 0; i < num_vertices; i++)
+    {
+        leaves[i].code = vertices[i]->address;
+        leaves[i].index = i;
+    }
+    radixSort(leaves, NDIM * max_depth);
+
+    codestring mask[NDIM];
+    for (int j = 0; j < NDIM; j++)
+        mask[j] = mortonAxisMask(j, max_depth);
+
+    /* matches[o]: (from, to) index pairs, to = from + offset o */
+    int num_offsets = NNEI / 2;
+    vector<vector<int> > matches(num_offsets);
+
+    getThreadPool(NUM_THREADS).run(num_offsets, [&](int o)
+    {
+        int offset[NDIM];
+        codestring step[NDIM];
+        for (int j = 0, i = NNEI / 2 + 1 + o; j < NDIM; j++, i /= DIAM)
+        {
+            offset[j] = (i % DIAM) - FOOT;
+            step[j] = mortonStep(j, offset[j], max_depth);
+        }
+
+        /* An offset as wide as the grid reaches no leaf, and would wrap onto one */
+        for (int j = 0; j < NDIM; j++)
+            if (labs(offset[j]) >= (1l << max_depth))
+                return;
+
+        // 1. Shift every leaf, dropping those that leave the volume
+        vector<CodeIndex> shifted, scratch;
+        shifted.reserve(num_vertices);
+        for (int l = 0; l < num_vertices; l++)
+        {
+            codestring code = leaves[l].code, moved_code = 0;
+            bool inside = true;
+            for (int j = 0; j < NDIM && inside; j++)
+            {
+                codestring own = code & mask[j],
+                           moved = mortonAddAxis(code, step[j], mask[j]);
+                inside = (offset[j] >= 0 || moved < own) && (offset[j] <= 0 || moved > own);
+                moved_code |= moved;
+            }
+            if (inside)
+            {
+                CodeIndex key = {moved_code, leaves[l].index};
+                shifted.push_back(key);
+            }
+        }
+
+        // 2. Sort, and join against the leaves
+        if (shifted.empty())
+            return;
+        scratch.resize(shifted.size());
+        radixSort(&shifted[0], &scratch[0], shifted.size(), NDIM * max_depth);
+
+        vector<int> &found = matches[o];
+        int l = 0;
+        for (unsigned int s = 0; s < shifted.size(); s++)
+        {
+            while (l < num_vertices && leaves[l].code < shifted[s].code)
+                l++;
+            if (l == num_vertices)
+                break;
+            if (leaves[l].code == shifted[s].code)
+            {
+                int from = shifted[s].index, to = leaves[l].index;
+                found.push_back(from);
+                found.push_back(to);
+
+                /* Each offset owns its own column of slots, and the mirrored one */
+                if (use_slots)
+                {
+                    slots[(size_t) NNEI * from + NNEI / 2 + 1 + o] = to;
+                    slots[(size_t) NNEI * to + NNEI / 2 - 1 - o] = from;
+                }
+            }
+        }
+    });
+
+    // 3. Scatter both directions of every match into rows, in no particular order
+    vector<long> row_start(num_vertices + 1, 0), fill(num_vertices);
+    for (int o = 0; o < num_offsets; o++)
+        for (unsigned int m = 0; m < matches[o].size(); m++)
+            row_start[matches[o][m] + 1]++;
+    for (int i = 0; i < num_vertices; i++)
+        row_start[i + 1] += row_start[i];
+
+    vector<int> rows(row_start[num_vertices]), sorted_rows(rows.size());
+    copy(row_start.begin(), row_start.end() - 1, fill.begin());
+    for (int o = 0; o < num_offsets; o++)
+        for (unsigned int m = 0; m < matches[o].size(); m += 2)
+        {
+            int from = matches[o][m], to = matches[o][m + 1];
+            rows[fill[from]++] = to;
+            rows[fill[to]++] = from;
+        }
+    vector<vector<int> >().swap(matches);
+
+    // 4. Transpose: the relation is symmetric, so this only sorts each row by index
+    copy(row_start.begin(), row_start.end() - 1, fill.begin());
+    for (int i = 0; i < num_vertices; i++)
+        for (long r = row_start[i]; r < row_start[i + 1]; r++)
+            sorted_rows[fill[rows[r]]++] = i;
+
+    for (int i = 0; i < num_vertices; i++)
+    {
+        vector<OctreePoint *> &neighbors = vertices[i]->neighbors;
+        neighbors.resize(row_start[i + 1] - row_start[i]);
+        for (unsigned int n = 0; n < neighbors.size(); n++)
+            neighbors[n] = vertices[sorted_rows[row_start[i] + n]];
+    }
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void buildAdjacency(DistFunction)
+ * Description:  Pack the neighbor lists into compressed sparse row form, optionally
+ *                  storing weight(p, q) for every entry.  Each undirected edge appears
+ *                  in both rows, as it does in the neighbor lists.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreeGraph::buildAdjacency(DistFunction weight)
+{
+    PROFILE_SCOPE("buildAdjacency");
+    int num_vertices = vertices.size();
+
+    vector<long>(num_vertices + 1).swap(adj_offsets);
+    adj_offsets[0] = 0;
+    for (int i = 0; i < num_vertices; i++)
+        adj_offsets[i + 1] = adj_offsets[i] + vertices[i]->neighbors.size();
+
+    long num_entries = adj_offsets[num_vertices];
+    vector<int>(num_entries).swap(adj_indices);
+    if (weight != NULL)
+        vector<float>(num_entries).swap(adj_weights);
+    else
+        vector<float>().swap(adj_weights);
+
+    /* Rows are disjoint, so blocks of them can be filled independently */
+    const int BLOCK = 4096;
+    int num_blocks = (num_vertices + BLOCK - 1) / BLOCK;
+
+    getThreadPool(NUM_THREADS).run(num_blocks, [&](int b)
+    {
+        int begin = b * BLOCK,
+            end = min(begin + BLOCK, num_vertices);
+        for (int i = begin; i < end; i++)
+        {
+            OctreePoint *p = vertices[i];
+            long row = adj_offsets[i];
+            for (unsigned int j = 0; j < p->neighbors.size(); j++)
+            {
+                adj_indices[row + j] = p->neighbors[j]->index;
+                if (weight != NULL)
+                    adj_weights[row + j] = weight(p, p->neighbors[j]);
+            }
+        }
+    });
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeGraph
+ *      Method:  void releasePointerEdges()
+ * Description:  Free the OctreeEdges and every vertex's neighbor list, leaving the CSR
+ *                  arrays as the only adjacency.  Adding points afterwards rebuilds all
+ *                  the edges from scratch.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreeGraph::releasePointerEdges()
+{
+    clearEdges();
+    for (unsigned int i = 0; i < vertices.size(); i++)
+        vector<OctreePoint *>().swap(vertices[i]->neighbors);
+    edges_released = true;
+}
+
+/* Drop the CSR arrays */
+void OctreeGraph::clearAdjacency()
+{
+    vector<long>().swap(adj_offsets);
+    vector<int>().swap(adj_indices);
+    vector<float>().swap(adj_weights);
+}
+
+/* Release every edge */
+void OctreeGraph::clearEdges()
+{
+    if (use_arena)
+        edge_pool.clear();
+    else
+        for (unsigned int i = 0; i < edges.size(); i++)
+            delete edges[i];
+    edges.clear();
 }
 
 /*
@@ -249,4 +660,87 @@ int OctreeGraph::getNumEdges() const
     return edges.size();
 }
 
+bool OctreeGraph::hasAdjacency() const
+{
+    return !adj_offsets.empty();
+}
+
+bool OctreeGraph::hasWeights() const
+{
+    return !adj_weights.empty();
+}
+
+/* Number of neighbors of vertex i in the CSR arrays (0 before buildAdjacency) */
+int OctreeGraph::getDegree(int i) const
+{
+    if (!hasAdjacency())
+        return 0;
+    return adj_offsets[i + 1] - adj_offsets[i];
+}
+
+/* Indices of the neighbors of vertex i, ascending */
+Span<const int> OctreeGraph::getAdjacent(int i) const
+{
+    if (!hasAdjacency())
+        return Span<const int>();
+    return Span<const int>(adj_indices.data() + adj_offsets[i], getDegree(i));
+}
+
+/* Weights of the edges to getAdjacent(i), in the same order; empty without weights */
+Span<const float> OctreeGraph::getWeights(int i) const
+{
+    if (!hasWeights())
+        return Span<const float>();
+    return Span<const float>(adj_weights.data() + adj_offsets[i], getDegree(i));
+}
+
+/* Total number of CSR entries (twice the number of undirected edges) */
+long OctreeGraph::getNumAdjacent() const
+{
+    return adj_indices.size();
+}
+
+bool OctreeGraph::hasSlots() const
+{
+    return !slots.empty();
+}
+
+/* The NNEI slots of vertex i, indexed by stencilSlot; empty without slots */
+Span<const int> OctreeGraph::getSlots(int i) const
+{
+    if (!hasSlots())
+        return Span<const int>();
+    return Span<const int>(slots.data() + (size_t) NNEI * i, NNEI);
+}
+
+/* Index of the vertex at the given offset from vertex i; -1 if there is none, or if
+ * the graph keeps no slots */
+int OctreeGraph::getNeighborIndex(int i, const int relative_coords[NDIM]) const
+{
+    int slot = stencilSlot(relative_coords);
+    return (slot < 0 || !hasSlots()) ? -1 : slots[(size_t) NNEI * i + slot];
+}
+
+OctreePoint *OctreeGraph::getNeighbor(int i, const int relative_coords[NDIM])
+{
+    int index = getNeighborIndex(i, relative_coords);
+    return (index < 0) ? NULL : vertices[index];
+}
+
+/* Bytes obtained for, and occupied by, the edge pool (zero when edges use new), the
+ * CSR arrays and the stencil slots */
+size_t OctreeGraph::bytesReserved() const
+{
+    return edge_pool.bytesReserved() + adj_offsets.capacity() * sizeof(long)
+           + adj_indices.capacity() * sizeof(int) + adj_weights.capacity() * sizeof(float)
+           + slots.capacity() * sizeof(int);
+}
+
+size_t OctreeGraph::bytesUsed() const
+{
+    return edge_pool.bytesUsed() + adj_offsets.size() * sizeof(long)
+           + adj_indices.size() * sizeof(int) + adj_weights.size() * sizeof(float)
+           + slots.size() * sizeof(int);
+}
+
 
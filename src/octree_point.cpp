@@ -16,6 +16,7 @@
  * =====================================================================================
  */
 #include "octree.h"
+#include "stencil.h"
 #include <iomanip>
 #include <assert.h>
 #include <cmath>
@@ -108,61 +109,34 @@ void OctreePoint::add(const PointIter begin, const PointIter end) {
  *--------------------------------------------------------------------------------------
  *       Class:  OctreePoint
  *      Method:  void findNeighbors()
- * Description:  Find existing neighbors and link to them
+ * Description:  Fill the neighbor list from the tree, in index order.  Only reads the
+ *                  tree, so any number of points may search at once; the caller
+ *                  turns the lists into edges.
  *--------------------------------------------------------------------------------------
  */
-void OctreePoint::findNeighbors(OctreeGraph &graph) {
-    //if(((long)home)>0xffffffff)
-    //    return;
-
-    // 1. Build list of addresses
+void OctreePoint::findNeighbors() {
     neighbors.resize(0);
-    PointBuffer pb;
-    long loc_max = 1l << depth;
-
-    // cout << "int_location: ";
-    // for (int j = 0; j < NDIM; j++) cout << home->int_location[j] << " ";
-    // cout << endl;
-
-    for (int i = 0; i < NNEI; i++) {
-        if (i == NNEI / 2) continue;
-
-        int offset = i;
-        bool good_neighbor = true;
-        long new_int_location[NDIM];
-        for (int j = 0; j < NDIM; j++) {
-            int offset_j = (offset % DIAM) - FOOT;
-            new_int_location[j] = home->int_location[j] + offset_j;
-
-            /* Check whether this neighbor lies in the volume */
-            if (new_int_location[j] < 0 || new_int_location[j] >= loc_max) {
-                good_neighbor = false;
-                break;
-            }
-            offset = offset / DIAM;
-        }
-        // cout << "\ti=" << i << ", new_int_location: ";
-        // for (int k = 0; k < NDIM; k++) cout << new_int_location[k] << " ";
-        // cout << endl;
-
-        if (good_neighbor)
-            pb.emplace_back(new_int_location, home->max_depth);
-    }
 
-    if (!pb.empty()) {
-        // 2. Sort the tree
-        sort(pb.begin(), pb.end());
+    // 1. Build the sorted list of addresses
+    static thread_local vector<codestring> codes;
+    codes.resize(NNEI);
+    int num_codes = stencilCodes(address, home->max_depth, &codes[0]);
 
-        // 3. Move up the tree
-        Octree *root = home->searchUp(pb.front().code, pb.back().code);
+    if (num_codes > 0) {
+        // 2. Move up the tree
+        Octree *root = home->searchUp(codes[0], codes[num_codes - 1]);
 
-        // 4. Fill neighbor vector
-        root->findPoints(pb.begin(), pb.end(), neighbors, false);
+        // 3. Fill neighbor vector
+        root->findCodes(&codes[0], &codes[0] + num_codes, neighbors);
     }
 
-    sort(neighbors.begin(), neighbors.end());
-    for (unsigned int i = 0; i < neighbors.size(); i++)
-        graph.addEdge(this, neighbors[i]);
+    /* Index order does not depend on where the leaves happened to be allocated */
+    sort(neighbors.begin(), neighbors.end(), index_less);
+}
+
+bool index_less(const OctreePoint *p1, const OctreePoint *p2)
+{
+    return p1->getIndex() < p2->getIndex();
 }
 
 
@@ -180,77 +154,140 @@ void OctreePoint::computeNormal() {
     double l_mat[NDIM][NDIM];
     computeCovariance(l_mat, sigma);
 
-    double trace = 0;
-    for (int i = 0; i < NDIM; i++)
-        trace += l_mat[i][i];
-
-    double v1[NDIM] = {1, 0, 0};
-    double e1 = lanczos(l_mat, v1, 20);
-
-    for (int i = 0; i < NDIM; i++)
-        l_mat[i][i] -= e1;
-
-    double v3[NDIM] = {0, 0, 1};
-    /*double e3 = e1 + */ lanczos(l_mat, v3, 40);
+    double evals[NDIM], evecs[NDIM][NDIM];
+    symmetricEigen(l_mat, evals, evecs);
+    setNormal(evals, evecs);
+}
 
-    // double e2 = trace - e1 - e3;
-    scale(v3, 1 / sqrt(norm2(v3)));
-    copyTo(v3, normal);
-    // cout << "debug_label=" << debug_label << "\n\n";
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreePoint
+ *      Method:  setNormal(const double[NDIM], const double[NDIM][NDIM])
+ * Description:  Take the normal from the eigenvector of the smallest eigenvalue of the
+ *                  covariance, pointing it to +z as the power iteration used to
+ *--------------------------------------------------------------------------------------
+ */
+void OctreePoint::setNormal(const double evals[NDIM], const double evecs[NDIM][NDIM]) {
+    // No spread at all: the normal is undefined
+    if (evals[NDIM - 1] <= 0) {
+        for (int i = 0; i < NDIM; i++)
+            normal[i] = NAN;
+        return;
+    }
 
-    // cout << "\t" << normal[0] << " " << normal[1] << " " << normal[2] << endl << endl;
+    copyTo(evecs[0], normal);
+    if (normal[NDIM - 1] < 0)
+        scale(normal, -1);
 }
 
 /*
  *      Method:  OctreePoint :: computeCovariance(double[NDIM][NDIM])
- * Description:
+ * Description:  Covariance over the neighbor list
  *--------------------------------------------------------------------------------------
  */
 void OctreePoint::computeCovariance(double cov[NDIM][NDIM], double sigma) {
-    int nnei = neighbors.size();
+    computeCovariance(neighbors, cov, sigma);
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreePoint
+ *      Method:  computeCovariance(const vector<OctreePoint*>&, double[NDIM][NDIM], double)
+ * Description:  Gaussian-weighted covariance of the given leaves (not including this
+ *                  one) around their weighted center.  Lists no longer than a stencil
+ *                  go to the kernel compiled for the current FOOT.
+ *--------------------------------------------------------------------------------------
+ */
+void OctreePoint::computeCovariance(const vector<OctreePoint*> &neighbors,
+                                    double cov[NDIM][NDIM], double sigma) {
+    switch (((int) neighbors.size() < NNEI) ? stencilFoot() : 0) {
+        case 1:
+            covarianceKernel<1>(neighbors, cov, sigma);
+            break;
+        case 2:
+            covarianceKernel<2>(neighbors, cov, sigma);
+            break;
+        case 3:
+            covarianceKernel<3>(neighbors, cov, sigma);
+            break;
+        default:
+            covarianceKernel<0>(neighbors, cov, sigma);
+            break;
+    }
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreePoint
+ *      Method:  covarianceKernel<F>(const vector<OctreePoint*>&, double[NDIM][NDIM],
+ *                  double)
+ * Description:  computeCovariance for at most (2F+1)^3-1 leaves, or any number when
+ *                  F = 0.  Offsets and weights are laid out one array per axis, in
+ *                  buffers of fixed size on the stack, so those loops vectorize; the
+ *                  sums are taken in list order, as they always were.
+ *--------------------------------------------------------------------------------------
+ */
+template <int F>
+void OctreePoint::covarianceKernel(const vector<OctreePoint*> &neighbors,
+                                   double cov[NDIM][NDIM], double sigma) {
+    const int CAPACITY = (2 * F + 1) * (2 * F + 1) * (2 * F + 1) - 1;
+    int nnei = neighbors.size(), stride = F ? CAPACITY : nnei;
+
+    double fixed_buffer[F ? (NDIM + 1) * CAPACITY : 1];
+    static thread_local vector<double> generic_buffer;
+    double *buffer = fixed_buffer;
+    if (!F) {
+        generic_buffer.resize((NDIM + 1) * max(nnei, 1));
+        buffer = &generic_buffer[0];
+    }
+    double *rel[NDIM], *weight = buffer + NDIM * stride;
+    for (int j = 0; j < NDIM; j++)
+        rel[j] = buffer + j * stride;
 
     // compute center
-    double ld[NDIM], center[NDIM], total_weight = 1;
+    for (int j = 0; j < NDIM; j++)
+        for (int i = 0; i < nnei; i++)
+            rel[j][i] = neighbors[i]->location[j] - location[j];
+    for (int i = 0; i < nnei; i++) {
+        double ld[NDIM] = {rel[0][i], rel[1][i], rel[2][i]};
+        weight[i] = gauss(ld, sigma);
+    }
+
+    double center[NDIM], total_weight = 1;
     copyTo(location, center);
     for (int i = 0; i < nnei; i++) {
-        sub(neighbors[i]->location, location, ld);
-        double weight = gauss(ld, sigma);
-        for (int j = 0; j < NDIM; j++) {
-            center[j] += weight * neighbors[i]->location[j];
-        }
-        total_weight += weight;
+        for (int j = 0; j < NDIM; j++)
+            center[j] += weight[i] * neighbors[i]->location[j];
+        total_weight += weight[i];
     }
     for (int j = 0; j < NDIM; j++)
         center[j] /= total_weight;
 
     // compute covariance around center
+    for (int j = 0; j < NDIM; j++)
+        for (int i = 0; i < nnei; i++)
+            rel[j][i] = neighbors[i]->location[j] - center[j];
+    for (int i = 0; i < nnei; i++) {
+        double ld[NDIM] = {rel[0][i], rel[1][i], rel[2][i]};
+        weight[i] = gauss(ld, sigma);
+    }
+    double resolution = 1 << depth;
+    for (int j = 0; j < NDIM; j++)
+        for (int i = 0; i < nnei; i++)
+            rel[j][i] *= resolution;
+
     for (int i = 0; i < NDIM; i++)
         for (int j = 0; j < NDIM; j++)
             cov[i][j] = 0;
-    for (int k = 0; k < nnei; k++) {
-        // Get relative location
-        sub(neighbors[k]->location, center, ld);
-        double weight = gauss(ld, sigma);
-        scale(ld, 1 << depth);
-
+    for (int k = 0; k < nnei; k++)
         for (int i = 0; i < NDIM; i++)
             for (int j = i; j < NDIM; j++)
-                cov[i][j] += weight * ld[i] * ld[j];
-    }
+                cov[i][j] += weight[k] * rel[i][k] * rel[j][k];
     for (int i = 0; i < NDIM; i++) {
         for (int j = 0; j < i; j++) {
             cov[i][j] = cov[j][i];
         }
     }
-
-    // cout << "COVAR:\n";
-    // for (int i = 0; i < NDIM; i++) {
-    //     for (int j = 0; j < NDIM; j++) {
-    //         cout << cov[i][j] << " ";
-    //     }
-    //     cout << endl;
-    // }
-    // cout << endl;
 }
 
 
@@ -268,27 +305,25 @@ OctreePoint *OctreePoint::getNeighbor(int i) const {
     return neighbors[i];
 }
 
+/* The point in v with address c, or NULL.  Neighbor lists are in index order, not
+ * code order, so this is a scan; OctreeGraph::getNeighbor is the constant-time form. */
 OctreePoint *searchVector(const vector<OctreePoint *> &v, codestring c) {
-    int begin = 0, end = v.size() - 1;
-
-    while (end > begin) {
-        int curr = (end + begin) / 2;
-        if (c <= v[curr]->address)
-            end = curr;
-        if (c >= v[curr]->address)
-            begin = curr;
-    }
-
-    if (c == v[begin]->address)
-        return v[begin];
-    else return NULL;
+    for (unsigned int i = 0; i < v.size(); i++)
+        if (v[i]->address == c)
+            return v[i];
+    return NULL;
 }
 
 
 OctreePoint *OctreePoint::getNeighbor(const int relative_coords[NDIM]) const {
-    long new_int_location[NDIM];
+    long new_int_location[NDIM], loc_max = 1l << home->max_depth;
     sum(home->int_location, relative_coords, new_int_location);
 
+    /* Outside the volume, the code would wrap around to the far side */
+    for (int j = 0; j < NDIM; j++)
+        if (new_int_location[j] < 0 || new_int_location[j] >= loc_max)
+            return NULL;
+
     codestring c = locationToCode(new_int_location, home->max_depth);
     return searchVector(neighbors, c);
 }
@@ -321,6 +356,10 @@ int OctreePoint::getDepth() const {
     return depth;
 }
 
+int OctreePoint::getNumPoints() const {
+    return num_points;
+}
+
 /* #####   I/O   #################################################################### */
 
 /*
@@ -0,0 +1,402 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  octree_search.cpp
+ *
+ *    Description:  Metric queries over the averaged leaf locations of an Octree
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 08:58:06 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "octree.h"
+#include "radix_sort.h"
+#include "thread_pool.h"
+#include <limits>
+using namespace std;
+
+#define QUERY_BLOCK 256     // Consecutive (Morton-ordered) queries per batch task
+
+/* #####   TYPE DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ######################### */
+
+typedef pair<double, Octree *> NodeEntry;         // Squared box distance, node
+typedef pair<double, OctreePoint *> LeafEntry;    // Squared distance, leaf
+
+/*
+ * Buffers of one search, kept between the queries of a batch.  frontier is a min-heap
+ * of the nodes still to open; best is a max-heap of the k closest leaves found so far.
+ */
+struct Octree::SearchWorkspace
+{
+    vector<NodeEntry> frontier;
+    vector<LeafEntry> best;
+    vector<Octree *> stack;         // Nodes still to open in a radius search
+};
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+/* Heap order of the frontier: nearest box on top */
+static bool farther_node(const NodeEntry &a, const NodeEntry &b)
+{
+    return a.first > b.first;
+}
+
+/* Heap order of the results: farthest leaf on top; ties broken by index, so the
+ * k nearest are the same whichever order the leaves are visited in */
+static bool nearer_leaf(const LeafEntry &a, const LeafEntry &b)
+{
+    return a.first < b.first
+           || (a.first == b.first && a.second->getIndex() < b.second->getIndex());
+}
+
+/* Squared distance from q to the box [limits], zero inside it */
+static double box_distance2(const double *limits, const double *q)
+{
+    double total = 0;
+    for (int j = 0; j < NDIM; j++)
+    {
+        double gap = max(limits[2 * j] - q[j], q[j] - limits[2 * j + 1]);
+        if (gap > 0)
+            total += gap * gap;
+    }
+    return total;
+}
+
+static double point_distance2(const double *p, const double *q)
+{
+    double total = 0;
+    for (int j = 0; j < NDIM; j++)
+        total += (p[j] - q[j]) * (p[j] - q[j]);
+    return total;
+}
+
+/* Offer a leaf to the k-best heap */
+static void offer_leaf(vector<LeafEntry> &best, int k, double bound, OctreePoint *leaf,
+                       const double *query)
+{
+    LeafEntry entry(point_distance2(leaf->getLocation(), query), leaf);
+    if ((int) best.size() < k)
+    {
+        if (entry.first > bound)
+            return;
+        best.push_back(entry);
+        push_heap(best.begin(), best.end(), nearer_leaf);
+    }
+    else if (nearer_leaf(entry, best.front()))
+    {
+        pop_heap(best.begin(), best.end(), nearer_leaf);
+        best.back() = entry;
+        push_heap(best.begin(), best.end(), nearer_leaf);
+    }
+}
+
+/* Morton order of the queries, each clamped into the limits first */
+static void morton_order(const double *queries, int num_queries, const double *limits,
+                         int max_depth, vector<CodeIndex> &order)
+{
+    order.resize(num_queries);
+    for (int q = 0; q < num_queries; q++)
+    {
+        double clamped[NDIM];
+        for (int j = 0; j < NDIM; j++)
+            clamped[j] = min(max(queries[NDIM * q + j], limits[2 * j]), limits[2 * j + 1]);
+        order[q].code = CodedPoint(clamped, limits, max_depth).get_code();
+        order[q].index = q;
+    }
+    radixSort(order, NDIM * max_depth);
+}
+
+/* #####   Queries   ################################################################ */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void knnSearch(const double*, int, double, SearchWorkspace&)
+ * Description:  Best-first search for the k leaves nearest the query, by the distance
+ *                  to their averaged location.  A leaf's location lies inside its voxel,
+ *                  so the distance to a node's limits bounds every leaf below it; nodes
+ *                  are opened nearest first, and the search ends when the nearest
+ *                  unopened node is farther than the k-th leaf found.  Leaves farther
+ *                  than sqrt(bound) are never taken; a bound known to hold k leaves
+ *                  prunes the search from the start.  Leaves are left in work.best,
+ *                  nearest first.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::knnSearch(const double *query, int k, double bound, SearchWorkspace &work)
+{
+    vector<NodeEntry> &frontier = work.frontier;
+    vector<LeafEntry> &best = work.best;
+    frontier.clear();
+    best.clear();
+    if (k <= 0)
+        return;
+
+    if (depth == max_depth)
+    {
+        if (data != NULL)
+            offer_leaf(best, k, bound, data, query);
+        return;
+    }
+
+    frontier.push_back(NodeEntry(box_distance2(limits, query), this));
+    while (!frontier.empty())
+    {
+        double reach = ((int) best.size() == k) ? best.front().first : bound;
+        if (frontier.front().first > reach)
+            break;
+
+        Octree *node = frontier.front().second;
+        pop_heap(frontier.begin(), frontier.end(), farther_node);
+        frontier.pop_back();
+
+        for (int i = 0; i < NDIV; i++)
+        {
+            Octree *child = node->children[i];
+            if (child == NULL)
+                continue;
+
+            if (child->depth == max_depth)
+            {
+                if (child->data != NULL)
+                    offer_leaf(best, k, bound, child->data, query);
+                continue;
+            }
+
+            reach = ((int) best.size() == k) ? best.front().first : bound;
+            double child_distance = box_distance2(child->limits, query);
+            if (child_distance <= reach)
+            {
+                frontier.push_back(NodeEntry(child_distance, child));
+                push_heap(frontier.begin(), frontier.end(), farther_node);
+            }
+        }
+    }
+
+    sort_heap(best.begin(), best.end(), nearer_leaf);
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  int knn(const double*, int, vector<OctreePoint*>&, vector<double>*)
+ * Description:  The k leaves nearest the query (fewer if the tree has fewer), nearest
+ *                  first, with their Euclidean distances if distances is given.
+ *                  Returns the number found.
+ *--------------------------------------------------------------------------------------
+ */
+int Octree::knn(const double *query, int k, vector<OctreePoint *> &out,
+                vector<double> *distances)
+{
+    SearchWorkspace work;
+    knnSearch(query, k, numeric_limits<double>::infinity(), work);
+
+    out.resize(work.best.size());
+    if (distances != NULL)
+        distances->resize(work.best.size());
+    for (unsigned int i = 0; i < work.best.size(); i++)
+    {
+        out[i] = work.best[i].second;
+        if (distances != NULL)
+            (*distances)[i] = sqrt(work.best[i].first);
+    }
+    return out.size();
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void knnBatch(const double*, int, int, vector<OctreePoint*>&,
+ *                             vector<double>*)
+ * Description:  knn for each of num_queries queries (NDIM coordinates each).  The
+ *                  results of query q fill out[q*k .. q*k+k), nearest first, padded with
+ *                  NULL (and infinite distances) when the tree has fewer than k leaves.
+ *
+ *                  Queries are answered in Morton order, in blocks of QUERY_BLOCK run on
+ *                  NUM_THREADS threads.  Within a block, the leaves found for one query
+ *                  are k leaves near the next, so their distances to it bound its k-th
+ *                  neighbor before the search starts and most of the tree is never
+ *                  opened.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::knnBatch(const double *queries, int num_queries, int k,
+                      vector<OctreePoint *> &out, vector<double> *distances)
+{
+    k = max(k, 0);
+    out.assign((size_t) num_queries * k, NULL);
+    if (distances != NULL)
+        distances->assign((size_t) num_queries * k, numeric_limits<double>::infinity());
+
+    vector<CodeIndex> order;
+    morton_order(queries, num_queries, limits, max_depth, order);
+
+    int num_blocks = (num_queries + QUERY_BLOCK - 1) / QUERY_BLOCK;
+    getThreadPool(NUM_THREADS).run(num_blocks, [&](int b)
+    {
+        SearchWorkspace work;
+        vector<double> seeds;
+        int begin = b * QUERY_BLOCK, end = min(begin + QUERY_BLOCK, num_queries);
+
+        for (int i = begin; i < end; i++)
+        {
+            int q = order[i].index;
+            const double *query = &queries[NDIM * q];
+
+            /* k-th distance from this query to the previous query's leaves */
+            double bound = numeric_limits<double>::infinity();
+            if (i > begin && (int) work.best.size() == k)
+            {
+                seeds.resize(k);
+                for (int s = 0; s < k; s++)
+                    seeds[s] = point_distance2(work.best[s].second->getLocation(), query);
+                bound = *max_element(seeds.begin(), seeds.end());
+            }
+
+            knnSearch(query, k, bound, work);
+
+            for (unsigned int s = 0; s < work.best.size(); s++)
+            {
+                out[(size_t) q * k + s] = work.best[s].second;
+                if (distances != NULL)
+                    (*distances)[(size_t) q * k + s] = sqrt(work.best[s].first);
+            }
+        }
+    });
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void radiusCollect(const double*, double, vector<OctreePoint*>&,
+ *                                  vector<double>*, SearchWorkspace&)
+ * Description:  Append the leaves whose averaged location lies within sqrt(radius2) of
+ *                  center, in code order, with their squared distances if asked.  Only
+ *                  nodes whose limits meet the ball are opened, and only the leaves of
+ *                  those are measured.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::radiusCollect(const double *center, double radius2, vector<OctreePoint *> &out,
+                           vector<double> *distances2, SearchWorkspace &work)
+{
+    vector<Octree *> &stack = work.stack;
+    stack.clear();
+    if (box_distance2(limits, center) <= radius2)
+        stack.push_back(this);
+
+    while (!stack.empty())
+    {
+        Octree *node = stack.back();
+        stack.pop_back();
+
+        if (node->depth == max_depth)
+        {
+            if (node->data == NULL)
+                continue;
+            double distance2 = point_distance2(node->data->getLocation(), center);
+            if (distance2 <= radius2)
+            {
+                out.push_back(node->data);
+                if (distances2 != NULL)
+                    distances2->push_back(distance2);
+            }
+            continue;
+        }
+
+        /* Pushed last to first, so that they come off the stack in code order */
+        for (int i = NDIV - 1; i >= 0; i--)
+        {
+            Octree *child = node->children[i];
+            if (child != NULL && box_distance2(child->limits, center) <= radius2)
+                stack.push_back(child);
+        }
+    }
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  int radiusSearch(const double*, double, vector<OctreePoint*>&,
+ *                                vector<double>*)
+ * Description:  Every leaf whose averaged location lies within radius of center (the
+ *                  ball is closed), in code order, with their Euclidean distances if
+ *                  distances is given.  Returns the number found.
+ *--------------------------------------------------------------------------------------
+ */
+int Octree::radiusSearch(const double *center, double radius, vector<OctreePoint *> &out,
+                         vector<double> *distances)
+{
+    SearchWorkspace work;
+    out.clear();
+    if (distances != NULL)
+        distances->clear();
+    radiusCollect(center, radius * radius, out, distances, work);
+
+    if (distances != NULL)
+        for (unsigned int i = 0; i < distances->size(); i++)
+            (*distances)[i] = sqrt((*distances)[i]);
+    return out.size();
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Octree
+ *      Method:  void radiusSearchBatch(const double*, int, double, vector<long>&,
+ *                                      vector<OctreePoint*>&)
+ * Description:  radiusSearch for each of num_queries centres (NDIM coordinates each),
+ *                  in compressed rows: the leaves of query q are out[offsets[q] ..
+ *                  offsets[q+1]), in code order.  Queries are answered in Morton order,
+ *                  in blocks of QUERY_BLOCK on NUM_THREADS threads, so that neighboring
+ *                  queries open the same nodes while they are in cache; each block
+ *                  collects its rows, which are then copied into place.
+ *--------------------------------------------------------------------------------------
+ */
+void Octree::radiusSearchBatch(const double *centers, int num_queries, double radius,
+                               vector<long> &offsets, vector<OctreePoint *> &out)
+{
+    vector<CodeIndex> order;
+    morton_order(centers, num_queries, limits, max_depth, order);
+
+    int num_blocks = (num_queries + QUERY_BLOCK - 1) / QUERY_BLOCK;
+    vector<vector<OctreePoint *> > found(num_blocks);
+    vector<vector<long> > starts(num_blocks);
+    ThreadPool &pool = getThreadPool(NUM_THREADS);
+
+    pool.run(num_blocks, [&](int b)
+    {
+        SearchWorkspace work;
+        int begin = b * QUERY_BLOCK, end = min(begin + QUERY_BLOCK, num_queries);
+        starts[b].resize(end - begin + 1);
+        for (int i = begin; i < end; i++)
+        {
+            starts[b][i - begin] = found[b].size();
+            radiusCollect(&centers[NDIM * order[i].index], radius * radius, found[b], NULL,
+                          work);
+        }
+        starts[b][end - begin] = found[b].size();
+    });
+
+    /* Row lengths by query, then each block's rows to their place */
+    offsets.assign(num_queries + 1, 0);
+    for (int i = 0; i < num_queries; i++)
+    {
+        int b = i / QUERY_BLOCK, k = i % QUERY_BLOCK;
+        offsets[order[i].index + 1] = starts[b][k + 1] - starts[b][k];
+    }
+    for (int q = 0; q < num_queries; q++)
+        offsets[q + 1] += offsets[q];
+
+    out.resize(offsets[num_queries]);
+    pool.run(num_blocks, [&](int b)
+    {
+        int begin = b * QUERY_BLOCK, end = min(begin + QUERY_BLOCK, num_queries);
+        for (int i = begin; i < end; i++)
+            copy(found[b].begin() + starts[b][i - begin],
+                 found[b].begin() + starts[b][i - begin + 1],
+                 out.begin() + offsets[order[i].index]);
+    });
+}
@@ -0,0 +1,207 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  profile.cpp
+ *
+ *    Description:  Named phase timers and counters, aggregated in one registry
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 07:41:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "profile.h"
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+#include <time.h>
+
+using namespace std;
+
+static thread_local ScopedTimer *current_timer = NULL;
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+static void write_profile_at_exit()
+{
+    const char *filename = getenv("OCTREE_PROFILE_OUT");
+    getProfiler().writeJson(filename != NULL ? filename : "profile.json");
+}
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+long threadCpuNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1000000000l + now.tv_nsec;
+}
+
+Profiler &getProfiler()
+{
+    static Profiler profiler;
+    return profiler;
+}
+
+/* #####   PROFILE_PHASE / SCOPED_TIMER  -  MEMBER FUNCTION DEFINITIONS   ########### */
+
+void ProfilePhase::record(long wall, long self, long cpu)
+{
+    calls.fetch_add(1, memory_order_relaxed);
+    wall_ns.fetch_add(wall, memory_order_relaxed);
+    self_ns.fetch_add(self, memory_order_relaxed);
+    cpu_ns.fetch_add(cpu, memory_order_relaxed);
+
+    long longest = max_wall_ns.load(memory_order_relaxed);
+    while (wall > longest && !max_wall_ns.compare_exchange_weak(longest, wall))
+        ;
+}
+
+ScopedTimer::ScopedTimer(ProfilePhase *new_phase)
+    : phase(new_phase), outer(current_timer), inner_ns(0)
+{
+    current_timer = this;
+}
+
+ScopedTimer::~ScopedTimer()
+{
+    long wall = clock.wallNanoseconds(), cpu = clock.cpuNanoseconds();
+    phase->record(wall, wall - inner_ns, cpu);
+
+    if (outer != NULL)
+        outer->inner_ns += wall;
+    current_timer = outer;
+}
+
+/* #####   PROFILER  -  MEMBER FUNCTION DEFINITIONS   ############################### */
+
+Profiler::~Profiler()
+{
+    for (map<string, ProfilePhase *>::iterator it = phases.begin(); it != phases.end(); it++)
+        delete it->second;
+    for (map<string, atomic<long> *>::iterator it = counters.begin(); it != counters.end(); it++)
+        delete it->second;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Profiler
+ *      Method:  ProfilePhase *phase(const string&)
+ * Description:  The phase of the given name, created on first use.  The first entry
+ *                  also arranges for the registry to be written out at exit.
+ *--------------------------------------------------------------------------------------
+ */
+ProfilePhase *Profiler::phase(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    if (phases.empty() && counters.empty())
+        atexit(write_profile_at_exit);
+
+    ProfilePhase *&entry = phases[name];
+    if (entry == NULL)
+        entry = new ProfilePhase(name);
+    return entry;
+}
+
+atomic<long> *Profiler::counter(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    if (phases.empty() && counters.empty())
+        atexit(write_profile_at_exit);
+
+    atomic<long> *&entry = counters[name];
+    if (entry == NULL)
+        entry = new atomic<long>(0);
+    return entry;
+}
+
+long Profiler::getCalls(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    map<string, ProfilePhase *>::iterator it = phases.find(name);
+    return (it != phases.end()) ? it->second->calls.load() : 0;
+}
+
+double Profiler::getWallMs(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    map<string, ProfilePhase *>::iterator it = phases.find(name);
+    return (it != phases.end()) ? it->second->wall_ns.load() / 1e6 : 0;
+}
+
+double Profiler::getCpuMs(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    map<string, ProfilePhase *>::iterator it = phases.find(name);
+    return (it != phases.end()) ? it->second->cpu_ns.load() / 1e6 : 0;
+}
+
+long Profiler::getCount(const string &name)
+{
+    lock_guard<mutex> guard(lock);
+    map<string, atomic<long> *>::iterator it = counters.find(name);
+    return (it != counters.end()) ? it->second->load() : 0;
+}
+
+/* Zero every total, keeping the entries (and the pointers held to them) */
+void Profiler::reset()
+{
+    lock_guard<mutex> guard(lock);
+    for (map<string, ProfilePhase *>::iterator it = phases.begin(); it != phases.end(); it++)
+    {
+        ProfilePhase *p = it->second;
+        p->calls = 0;
+        p->wall_ns = 0;
+        p->self_ns = 0;
+        p->cpu_ns = 0;
+        p->max_wall_ns = 0;
+    }
+    for (map<string, atomic<long> *>::iterator it = counters.begin(); it != counters.end(); it++)
+        *it->second = 0;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  Profiler
+ *      Method:  void writeJson(ostream&)
+ * Description:  {"phases": {name: {calls, wall_ms, self_ms, cpu_ms, max_ms}, ...},
+ *                 "counters": {name: value, ...}}, both in name order
+ *--------------------------------------------------------------------------------------
+ */
+void Profiler::writeJson(ostream &out)
+{
+    lock_guard<mutex> guard(lock);
+    out << "{\n  \"phases\": {";
+    for (map<string, ProfilePhase *>::iterator it = phases.begin(); it != phases.end(); it++)
+    {
+        ProfilePhase *p = it->second;
+        out << (it == phases.begin() ? "\n" : ",\n") << fixed << setprecision(3)
+            << "    \"" << p->name << "\": {\"calls\": " << p->calls.load()
+            << ", \"wall_ms\": " << p->wall_ns.load() / 1e6
+            << ", \"self_ms\": " << p->self_ns.load() / 1e6
+            << ", \"cpu_ms\": " << p->cpu_ns.load() / 1e6
+            << ", \"max_ms\": " << p->max_wall_ns.load() / 1e6 << "}";
+    }
+    out << "\n  },\n  \"counters\": {";
+    for (map<string, atomic<long> *>::iterator it = counters.begin(); it != counters.end(); it++)
+        out << (it == counters.begin() ? "\n" : ",\n")
+            << "    \"" << it->first << "\": " << it->second->load();
+    out << "\n  }\n}\n";
+}
+
+bool Profiler::writeJson(const char *filename)
+{
+    ofstream out(filename);
+    if (out.fail())
+    {
+        cerr << "ERROR:  Could not write profile to " << filename << ".\n";
+        return false;
+    }
+    writeJson(out);
+    return out.good();
+}
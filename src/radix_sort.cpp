@@ -0,0 +1,142 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  radix_sort.cpp
+ *
+ *    Description:  LSD radix sort of codestring keys carrying a payload index
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 10:07:33 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "radix_sort.h"
+#include <string.h>
+
+/* #####   Helper Functions   ####################################################### */
+
+/* Stable insertion sort, for buffers too short to amortize the histograms */
+template<typename T, typename KeyOf>
+static void insertionSort(T *keys, int n, KeyOf key_of)
+{
+    for (int i = 1; i < n; i++)
+    {
+        T next = keys[i];
+        codestring next_key = key_of(next);
+        int j = i;
+        while (j > 0 && key_of(keys[j - 1]) > next_key)
+        {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = next;
+    }
+}
+
+/*
+ * LSD radix sort over RADIX_BITS digits of the low num_bits of each key.  All digit
+ * histograms are gathered in one read of the input, and passes in which every key has
+ * the same digit are skipped.  Returns a pointer to whichever buffer holds the result.
+ */
+template<typename T, typename KeyOf>
+static T *radixPasses(T *keys, T *scratch, int n, int num_bits, KeyOf key_of)
+{
+    int num_passes = (num_bits + RADIX_BITS - 1) / RADIX_BITS;
+    vector<int> counts(num_passes * RADIX_SIZE, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        codestring key = key_of(keys[i]);
+        for (int p = 0; p < num_passes; p++)
+            counts[p * RADIX_SIZE + ((key >> (p * RADIX_BITS)) & (RADIX_SIZE - 1))]++;
+    }
+
+    T *from = keys, *to = scratch;
+    for (int p = 0; p < num_passes; p++)
+    {
+        int *count = &counts[p * RADIX_SIZE];
+        int shift = p * RADIX_BITS;
+
+        /* All keys share this digit: nothing to do */
+        if (count[(key_of(from[0]) >> shift) & (RADIX_SIZE - 1)] == n)
+            continue;
+
+        /* Exclusive prefix sum gives each bucket's first slot */
+        int offset = 0;
+        for (int b = 0; b < RADIX_SIZE; b++)
+        {
+            int bucket_size = count[b];
+            count[b] = offset;
+            offset += bucket_size;
+        }
+
+        for (int i = 0; i < n; i++)
+            to[count[(key_of(from[i]) >> shift) & (RADIX_SIZE - 1)]++] = from[i];
+
+        T *temp = from;
+        from = to;
+        to = temp;
+    }
+
+    return from;
+}
+
+static inline codestring codeOf(const CodeIndex &key)
+{
+    return key.code;
+}
+
+static inline codestring codeOf(const codestring &key)
+{
+    return key;
+}
+
+template<typename T>
+static void sortBuffer(T *keys, T *scratch, int n, int num_bits)
+{
+    if (n < 2)
+        return;
+
+    if (num_bits > (int) (8 * sizeof(codestring)))
+        num_bits = 8 * sizeof(codestring);
+
+    if (n < RADIX_MIN_ELEMENTS)
+    {
+        insertionSort(keys, n, (codestring (*)(const T &)) codeOf);
+        return;
+    }
+
+    T *result = radixPasses(keys, scratch, n, num_bits, (codestring (*)(const T &)) codeOf);
+    if (result != keys)
+        memcpy(keys, result, n * sizeof(T));
+}
+
+/* #####   Exported Functions   ##################################################### */
+
+void radixSort(CodeIndex *keys, CodeIndex *scratch, int n, int num_bits)
+{
+    sortBuffer(keys, scratch, n, num_bits);
+}
+
+void radixSort(vector<CodeIndex> &keys, int num_bits)
+{
+    if (keys.size() < 2)
+        return;
+
+    vector<CodeIndex> scratch(keys.size());
+    sortBuffer(&keys[0], &scratch[0], keys.size(), num_bits);
+}
+
+void radixSort(vector<codestring> &codes, int num_bits)
+{
+    if (codes.size() < 2)
+        return;
+
+    vector<codestring> scratch(codes.size());
+    sortBuffer(&codes[0], &scratch[0], codes.size(), num_bits);
+}
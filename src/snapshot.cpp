@@ -0,0 +1,378 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  snapshot.cpp
+ *
+ *    Description:  Memory-mappable snapshots of a built Octree and OctreeGraph
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:26:02 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "snapshot.h"
+#include "radix_sort.h"
+#include <climits>
+#include <fstream>
+#include <string.h>
+
+static_assert(sizeof(SnapshotHeader) % SNAPSHOT_ALIGN == 0, "snapshot header must stay aligned");
+
+/* #####   FUNCTION DEFINITIONS  -  LOCAL TO THIS SOURCE FILE   ##################### */
+
+static uint64_t align_up(uint64_t offset)
+{
+    return (offset + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+}
+
+/* Number of elements in each section of a snapshot with this header, and their size */
+static void section_shape(const SnapshotHeader &header, uint64_t count[SNAPSHOT_SECTIONS],
+                          uint64_t element[SNAPSHOT_SECTIONS])
+{
+    uint64_t num_leaves = header.num_leaves, num_adjacent = header.num_adjacent;
+    count[SECTION_CODES] = num_leaves;
+    element[SECTION_CODES] = sizeof(codestring);
+    count[SECTION_LOCATIONS] = NDIM * num_leaves;
+    element[SECTION_LOCATIONS] = sizeof(double);
+    count[SECTION_NORMALS] = NDIM * num_leaves;
+    element[SECTION_NORMALS] = sizeof(float);
+    count[SECTION_NUM_POINTS] = num_leaves;
+    element[SECTION_NUM_POINTS] = sizeof(int32_t);
+    count[SECTION_ADJ_OFFSETS] = num_leaves + 1;
+    element[SECTION_ADJ_OFFSETS] = sizeof(int64_t);
+    count[SECTION_ADJ_INDICES] = num_adjacent;
+    element[SECTION_ADJ_INDICES] = sizeof(int32_t);
+    count[SECTION_ADJ_WEIGHTS] = header.has_weights ? num_adjacent : 0;
+    element[SECTION_ADJ_WEIGHTS] = sizeof(float);
+}
+
+/* Write a section at its offset, padding from the current position */
+static void write_section(ofstream &out, uint64_t offset, const void *data, size_t bytes)
+{
+    static const char zeros[SNAPSHOT_ALIGN] = {0};
+    uint64_t position = out.tellp();
+    out.write(zeros, offset - position);
+    if (bytes > 0)
+        out.write((const char *) data, bytes);
+}
+
+/* #####   FUNCTION DEFINITIONS  -  EXPORTED FUNCTIONS   ############################ */
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  bool saveSnapshot(const char*, Octree&, OctreeGraph&)
+ *  Description:  Write the leaves and adjacency of a built graph.  Leaves are renumbered
+ *                  in code order, so that a snapshot can be searched by address; the
+ *                  adjacency is taken from the CSR arrays if the graph has them and from
+ *                  the neighbor lists otherwise.
+ * =====================================================================================
+ */
+bool saveSnapshot(const char *filename, Octree &tree, OctreeGraph &graph)
+{
+    int num_leaves = graph.getNumVertices();
+    bool use_csr = graph.hasAdjacency();
+
+    /* New numbering: rank[old index] = position in code order */
+    vector<CodeIndex> order(num_leaves);
+    for (int i = 0; i < num_leaves; i++)
+    {
+        order[i].code = graph.getVertex(i)->getAddress();
+        order[i].index = i;
+    }
+    radixSort(order, NDIM * tree.max_depth);
+
+    vector<int> rank(num_leaves);
+    for (int i = 0; i < num_leaves; i++)
+        rank[order[i].index] = i;
+
+    /* Leaf sections */
+    vector<codestring> codes(num_leaves);
+    vector<double> locations((size_t) NDIM * num_leaves);
+    vector<float> normals((size_t) NDIM * num_leaves);
+    vector<int32_t> num_points(num_leaves);
+    vector<int64_t> adj_offsets(num_leaves + 1, 0);
+
+    for (int i = 0; i < num_leaves; i++)
+    {
+        OctreePoint *p = graph.getVertex(order[i].index);
+        codes[i] = order[i].code;
+        for (int j = 0; j < NDIM; j++)
+        {
+            locations[NDIM * i + j] = p->getLocation()[j];
+            normals[NDIM * i + j] = p->getNormal()[j];
+        }
+        num_points[i] = p->getNumPoints();
+
+        int degree = use_csr ? graph.getDegree(order[i].index) : p->getNeighbors().size();
+        adj_offsets[i + 1] = adj_offsets[i] + degree;
+    }
+
+    /* Adjacency, each row renumbered and put back in ascending order */
+    bool has_weights = use_csr && graph.hasWeights();
+    vector<int32_t> adj_indices(adj_offsets[num_leaves]);
+    vector<float> adj_weights(has_weights ? adj_offsets[num_leaves] : 0);
+    vector<pair<int, float> > row;
+
+    for (int i = 0; i < num_leaves; i++)
+    {
+        int old_index = order[i].index;
+        row.clear();
+        if (use_csr)
+        {
+            Span<const int> adjacent = graph.getAdjacent(old_index);
+            for (int k = 0; k < adjacent.size(); k++)
+                row.push_back(make_pair(rank[adjacent[k]],
+                                        has_weights ? graph.getWeights(old_index)[k] : 0.0f));
+        }
+        else
+        {
+            vector<OctreePoint *> &neighbors = graph.getVertex(old_index)->getNeighbors();
+            for (unsigned int k = 0; k < neighbors.size(); k++)
+                row.push_back(make_pair(rank[neighbors[k]->getIndex()], 0.0f));
+        }
+        sort(row.begin(), row.end());
+
+        for (unsigned int k = 0; k < row.size(); k++)
+        {
+            adj_indices[adj_offsets[i] + k] = row[k].first;
+            if (has_weights)
+                adj_weights[adj_offsets[i] + k] = row[k].second;
+        }
+    }
+
+    /* Header and section layout */
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.ndim = NDIM;
+    header.max_depth = tree.max_depth;
+    header.num_leaves = num_leaves;
+    header.num_adjacent = adj_indices.size();
+    for (int i = 0; i < 2 * NDIM; i++)
+        header.limits[i] = tree.getLimits()[i];
+    header.has_weights = has_weights;
+
+    const void *sections[SNAPSHOT_SECTIONS] = {codes.data(), locations.data(), normals.data(),
+                                               num_points.data(), adj_offsets.data(),
+                                               adj_indices.data(), adj_weights.data()};
+    size_t bytes[SNAPSHOT_SECTIONS] = {codes.size() * sizeof(codestring),
+                                       locations.size() * sizeof(double),
+                                       normals.size() * sizeof(float),
+                                       num_points.size() * sizeof(int32_t),
+                                       adj_offsets.size() * sizeof(int64_t),
+                                       adj_indices.size() * sizeof(int32_t),
+                                       adj_weights.size() * sizeof(float)};
+
+    uint64_t offset = sizeof(header);
+    for (int s = 0; s < SNAPSHOT_SECTIONS; s++)
+    {
+        header.section_offsets[s] = align_up(offset);
+        offset = header.section_offsets[s] + bytes[s];
+    }
+    header.file_size = offset;
+
+    ofstream out(filename, ios::binary | ios::trunc);
+    if (out.fail())
+    {
+        cout << "ERROR:  Could not open " << filename << " for writing.\n";
+        return false;
+    }
+    out.write((const char *) &header, sizeof(header));
+    for (int s = 0; s < SNAPSHOT_SECTIONS; s++)
+        write_section(out, header.section_offsets[s], sections[s], bytes[s]);
+
+    if (!out.good())
+    {
+        cout << "ERROR:  Could not write snapshot " << filename << ".\n";
+        return false;
+    }
+    return true;
+}
+
+/* #####   OCTREE_SNAPSHOT  -  MEMBER FUNCTION DEFINITIONS   ######################## */
+
+OctreeSnapshot::OctreeSnapshot()
+{
+    header = NULL;
+    codes = NULL;
+    locations = NULL;
+    normals = NULL;
+    num_points = NULL;
+    adj_offsets = NULL;
+    adj_indices = NULL;
+    adj_weights = NULL;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  OctreeSnapshot
+ *      Method:  bool open(const char*)
+ * Description:  Map a snapshot and point the accessors at its sections.  The header
+ *                  is checked (magic, version, byte order, dimension, and every section
+ *                  lying wholly inside the file), and so is the adjacency: the offsets
+ *                  must rise from 0 to num_adjacent, and every neighbor index must name
+ *                  a leaf, so that no span or accessor reaches past the map.  The other
+ *                  sections are not read.
+ *--------------------------------------------------------------------------------------
+ */
+bool OctreeSnapshot::open(const char *filename)
+{
+    close();
+    if (!file.open(filename))
+    {
+        cout << "ERROR:  Could not map snapshot " << filename << ".\n";
+        return false;
+    }
+
+    const SnapshotHeader *candidate = (const SnapshotHeader *) file.data;
+    const char *problem = NULL;
+    if (file.size < sizeof(SnapshotHeader)
+        || strncmp(candidate->magic, SNAPSHOT_MAGIC, sizeof(candidate->magic)) != 0)
+        problem = "not a snapshot";
+    else if (candidate->byte_order != SNAPSHOT_BYTE_ORDER)
+        problem = "written with the other byte order";
+    else if (candidate->version != SNAPSHOT_VERSION)
+        problem = "unsupported version";
+    else if (candidate->ndim != NDIM)
+        problem = "wrong dimension";
+    else if (candidate->file_size != file.size)
+        problem = "truncated";
+    else if (candidate->num_leaves < 0 || candidate->num_leaves >= INT_MAX
+             || candidate->num_adjacent < 0)
+        problem = "corrupt header";
+    else
+    {
+        uint64_t count[SNAPSHOT_SECTIONS], element[SNAPSHOT_SECTIONS];
+        section_shape(*candidate, count, element);
+        for (int s = 0; s < SNAPSHOT_SECTIONS && problem == NULL; s++)
+        {
+            uint64_t offset = candidate->section_offsets[s];
+            if (offset % SNAPSHOT_ALIGN != 0 || offset > file.size
+                || count[s] > (file.size - offset) / element[s])
+                problem = "corrupt section table";
+        }
+    }
+
+    /* Every row of the adjacency within its section, every neighbor a leaf */
+    if (problem == NULL)
+    {
+        const int64_t *rows =
+            (const int64_t *) (file.data + candidate->section_offsets[SECTION_ADJ_OFFSETS]);
+        const int32_t *neighbors =
+            (const int32_t *) (file.data + candidate->section_offsets[SECTION_ADJ_INDICES]);
+        int64_t num_leaves = candidate->num_leaves;
+        if (rows[0] != 0 || rows[num_leaves] != candidate->num_adjacent)
+            problem = "inconsistent adjacency";
+        for (int64_t i = 0; i < num_leaves && problem == NULL; i++)
+            if (rows[i + 1] < rows[i])
+                problem = "inconsistent adjacency";
+        for (int64_t k = 0; k < candidate->num_adjacent && problem == NULL; k++)
+            if (neighbors[k] < 0 || neighbors[k] >= num_leaves)
+                problem = "inconsistent adjacency";
+    }
+
+    if (problem != NULL)
+    {
+        cout << "ERROR:  Snapshot " << filename << " is " << problem << ".\n";
+        file.close();
+        return false;
+    }
+
+    header = candidate;
+    const uint64_t *offsets = header->section_offsets;
+    codes = (const codestring *) (file.data + offsets[SECTION_CODES]);
+    locations = (const double *) (file.data + offsets[SECTION_LOCATIONS]);
+    normals = (const float *) (file.data + offsets[SECTION_NORMALS]);
+    num_points = (const int32_t *) (file.data + offsets[SECTION_NUM_POINTS]);
+    adj_offsets = (const int64_t *) (file.data + offsets[SECTION_ADJ_OFFSETS]);
+    adj_indices = (const int32_t *) (file.data + offsets[SECTION_ADJ_INDICES]);
+    adj_weights = header->has_weights ? (const float *) (file.data + offsets[SECTION_ADJ_WEIGHTS]) : NULL;
+    return true;
+}
+
+void OctreeSnapshot::close()
+{
+    file.close();
+    header = NULL;
+}
+
+/* #####   Accessors   ############################################################## */
+
+int OctreeSnapshot::getNumLeaves() const
+{
+    return (header != NULL) ? header->num_leaves : 0;
+}
+
+int OctreeSnapshot::getMaxDepth() const
+{
+    return header->max_depth;
+}
+
+const double *OctreeSnapshot::getLimits() const
+{
+    return header->limits;
+}
+
+codestring OctreeSnapshot::getAddress(int leaf) const
+{
+    return codes[leaf];
+}
+
+const double *OctreeSnapshot::getLocation(int leaf) const
+{
+    return &locations[NDIM * leaf];
+}
+
+const float *OctreeSnapshot::getNormal(int leaf) const
+{
+    return &normals[NDIM * leaf];
+}
+
+int OctreeSnapshot::getNumPoints(int leaf) const
+{
+    return num_points[leaf];
+}
+
+bool OctreeSnapshot::hasWeights() const
+{
+    return adj_weights != NULL;
+}
+
+int OctreeSnapshot::getDegree(int leaf) const
+{
+    return adj_offsets[leaf + 1] - adj_offsets[leaf];
+}
+
+/* Neighbors of a leaf, in ascending order; open() checked that each names a leaf */
+Span<const int> OctreeSnapshot::getAdjacent(int leaf) const
+{
+    return Span<const int>(adj_indices + adj_offsets[leaf], getDegree(leaf));
+}
+
+/* Weights of the edges to getAdjacent(leaf); empty without weights */
+Span<const float> OctreeSnapshot::getWeights(int leaf) const
+{
+    if (adj_weights == NULL)
+        return Span<const float>();
+    return Span<const float>(adj_weights + adj_offsets[leaf], getDegree(leaf));
+}
+
+long OctreeSnapshot::getNumAdjacent() const
+{
+    return header->num_adjacent;
+}
+
+/* Leaf with the given address, or -1 */
+int OctreeSnapshot::findAddress(codestring address) const
+{
+    const codestring *end = codes + getNumLeaves(),
+                     *found = lower_bound(codes, end, address);
+    return (found != end && *found == address) ? found - codes : -1;
+}
@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  stencil.cpp
+ *
+ *    Description:  Neighbor codes of the FOOT stencil by dilated-integer arithmetic,
+ *                  one kernel per common FOOT and a generic one
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 11:02:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "stencil.h"
+#include "morton.h"
+
+static stencil_enum stencil_path = STENCIL_FIXED;
+
+/* #####   Offset tables   ########################################################## */
+
+template <int... K> struct IndexList {};
+
+template <int N, int... K> struct MakeIndices : MakeIndices<N - 1, N - 1, K...> {};
+
+template <int... K> struct MakeIndices<0, K...>
+{
+    typedef IndexList<K...> type;
+};
+
+/*
+ * The axis offsets -F..F spread onto the x bits of a code, as constants; shifting left
+ * by j moves them onto axis j.  Offsets are spread from MORTON_MAX_DEPTH bits, which
+ * serves every depth: the bits above a code's own are masked off after the addition.
+ * At depths where F is as wide as the grid, the kernel skips the outer entries.
+ */
+template <int F, typename Indices = typename MakeIndices<2 * F + 1>::type>
+struct FootSteps;
+
+template <int F, int... K>
+struct FootSteps<F, IndexList<K...> >
+{
+    static constexpr codestring step[2 * F + 1] = {mortonSpread((codestring) (K - F))...};
+};
+
+template <int F, int... K>
+constexpr codestring FootSteps<F, IndexList<K...> >::step[2 * F + 1];
+
+/* The generic kernel's table: built from FOOT and the depth, once per thread */
+struct GenericSteps
+{
+    int foot, max_depth;
+    vector<codestring> step[NDIM];
+    vector<codestring> buffer;
+};
+
+static GenericSteps &genericSteps(int max_depth)
+{
+    static thread_local GenericSteps steps;
+    static thread_local bool built = false;
+    if (built && steps.foot == FOOT && steps.max_depth == max_depth)
+        return steps;
+
+    for (int j = 0; j < NDIM; j++)
+    {
+        steps.step[j].resize(DIAM);
+        for (int k = 0; k < DIAM; k++)
+            steps.step[j][k] = mortonStep(j, k - FOOT, max_depth);
+    }
+    steps.buffer.resize(NDIM * DIAM + 2 * DIAM * DIAM + NNEI);
+    steps.foot = FOOT;
+    steps.max_depth = max_depth;
+    built = true;
+    return steps;
+}
+
+/* #####   Kernels   ################################################################ */
+
+/*
+ * Merge the consecutive sorted runs of length run in codes[0, n) into one sorted run.
+ * Returns whichever of codes and scratch holds it.
+ */
+static codestring *mergeRuns(codestring *codes, codestring *scratch, int n, int run)
+{
+    for (; run > 0 && run < n; run *= 2)
+    {
+        for (int begin = 0; begin < n; begin += 2 * run)
+        {
+            int middle = min(begin + run, n), end = min(begin + 2 * run, n);
+            merge(codes + begin, codes + middle, codes + middle, codes + end, scratch + begin);
+        }
+        swap(codes, scratch);
+    }
+    return codes;
+}
+
+/*
+ * ===  FUNCTION  ======================================================================
+ *         Name:  int stencilKernel<F>(codestring, int, codestring*)
+ *  Description:  stencilCodes for FOOT = F, or for any FOOT when F = 0.
+ *
+ *                  Per axis, each offset is added to the code's dilated coordinate
+ *                  with masked carries; a carry out of the top or a borrow wraps,
+ *                  which marks the neighbor as outside the volume.  That test only
+ *                  holds for offsets narrower than the grid, which wrap at most once;
+ *                  wider ones never land inside and are skipped.  Each axis comes
+ *                  out increasing, and the order of the (x, y) plane is the same in
+ *                  every z layer, so merging presorted runs twice sorts the block.
+ * =====================================================================================
+ */
+template <int F>
+static int stencilKernel(codestring code, int max_depth, codestring *out)
+{
+    const int foot = F ? F : FOOT, diam = 2 * foot + 1;
+    const long width = 1l << max_depth;
+    const int FIXED_DIAM = 2 * F + 1,
+              FIXED_SIZE = NDIM * FIXED_DIAM + 2 * FIXED_DIAM * FIXED_DIAM
+                           + FIXED_DIAM * FIXED_DIAM * FIXED_DIAM;
+
+    codestring fixed_buffer[F ? FIXED_SIZE : 1];
+    GenericSteps *generic = F ? NULL : &genericSteps(max_depth);
+    codestring *buffer = F ? fixed_buffer : &generic->buffer[0];
+
+    codestring *axis[NDIM], *plane = buffer + NDIM * diam,
+               *plane_scratch = plane + diam * diam, *scratch = plane_scratch + diam * diam;
+    int num_axis[NDIM];
+
+    // 1. Per axis, the dilated coordinates of the in-volume offsets, in increasing order
+    for (int j = 0; j < NDIM; j++)
+    {
+        codestring mask = mortonAxisMask(j, max_depth), own = code & mask;
+        axis[j] = buffer + j * diam;
+        num_axis[j] = 0;
+        for (int k = 0; k < diam; k++)
+        {
+            if (labs(k - foot) >= width)
+                continue;
+            codestring step = F ? FootSteps<F>::step[k] << j : generic->step[j][k],
+                       moved = mortonAddAxis(code, step, mask);
+            if ((k > foot && moved < own) || (k < foot && moved > own))
+                continue;
+            axis[j][num_axis[j]++] = moved;
+        }
+    }
+
+    // 2. The (x, y) plane, then the whole block
+    int num_plane = 0;
+    for (int b = 0; b < num_axis[1]; b++)
+        for (int a = 0; a < num_axis[0]; a++)
+            plane[num_plane++] = axis[0][a] | axis[1][b];
+    plane = mergeRuns(plane, plane_scratch, num_plane, num_axis[0]);
+
+    int num_codes = 0;
+    for (int c = 0; c < num_axis[2]; c++)
+        for (int i = 0; i < num_plane; i++)
+            out[num_codes++] = plane[i] | axis[2][c];
+    codestring *sorted = mergeRuns(out, scratch, num_codes, num_plane);
+
+    // 3. Leave out the centre
+    codestring *centre = lower_bound(sorted, sorted + num_codes, code);
+    copy(sorted, centre, out);
+    copy(centre + 1, sorted + num_codes, out + (centre - sorted));
+    return num_codes - 1;
+}
+
+/* #####   Exported functions   ##################################################### */
+
+int stencilCodes(codestring code, int max_depth, codestring *out)
+{
+    switch (stencilFoot())
+    {
+        case 1:
+            return stencilKernel<1>(code, max_depth, out);
+        case 2:
+            return stencilKernel<2>(code, max_depth, out);
+        case 3:
+            return stencilKernel<3>(code, max_depth, out);
+        default:
+            return stencilKernel<0>(code, max_depth, out);
+    }
+}
+
+int stencilFoot()
+{
+    if (stencil_path == STENCIL_FIXED && FOOT >= 1 && FOOT <= STENCIL_MAX_FOOT)
+        return FOOT;
+    return 0;
+}
+
+void setStencilPath(stencil_enum path)
+{
+    stencil_path = path;
+}
+
+stencil_enum getStencilPath()
+{
+    return stencil_path;
+}
+
+const char *stencilPathName(stencil_enum path)
+{
+    switch (path)
+    {
+    case STENCIL_GENERIC: return "generic";
+    case STENCIL_FIXED:   return "fixed";
+    }
+    return "unknown";
+}
@@ -0,0 +1,212 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  thread_pool.cpp
+ *
+ *    Description:  Fork-join work-stealing thread pool
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 01:31:09 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Joshua Hernandez (jah), endopol@gmail.com
+ *   Organization:  UCLA Vision Lab (vision.cs.ucla.edu)
+ *
+ * =====================================================================================
+ */
+#include "thread_pool.h"
+#include <map>
+
+using namespace std;
+
+static thread_local int worker_id = 0;
+static thread_local int task_depth = 0;    // Tasks this thread is running, nested
+
+/* #####   Constructors/Destructors   ############################################### */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  ThreadPool
+ *      Method:  ThreadPool(int)
+ * Description:  Start num_threads-1 workers; the caller of run() is participant 0
+ *--------------------------------------------------------------------------------------
+ */
+ThreadPool::ThreadPool(int num_threads)
+{
+    if (num_threads < 1)
+        num_threads = 1;
+
+    job = NULL;
+    generation = 0;
+    remaining = 0;
+    stopping = false;
+
+    for (int i = 0; i < num_threads; i++)
+        queues.push_back(new TaskQueue);
+    for (int i = 1; i < num_threads; i++)
+        workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    wake_workers.notify_all();
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        workers[i].join();
+    for (unsigned int i = 0; i < queues.size(); i++)
+        delete queues[i];
+}
+
+/* #####   Scheduling   ############################################################# */
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  ThreadPool
+ *      Method:  void run(int, const function<void(int)>&)
+ * Description:  Run task(0) ... task(num_tasks-1) across the pool and wait for them.
+ *                  A call from inside a task runs inline; calls from other threads
+ *                  wait their turn.
+ *--------------------------------------------------------------------------------------
+ */
+void ThreadPool::run(int num_tasks, const function<void(int)> &task)
+{
+    if (num_tasks <= 0)
+        return;
+
+    /* Nothing to share the work with, or already inside a batch: queueing would
+     * overwrite the running batch, or wait on it forever */
+    if (queues.size() == 1 || num_tasks == 1 || task_depth > 0 || currentWorker() != 0)
+    {
+        task_depth++;
+        for (int i = 0; i < num_tasks; i++)
+            task(i);
+        task_depth--;
+        return;
+    }
+
+    lock_guard<mutex> batch_guard(batch_lock);
+    {
+        unique_lock<mutex> guard(lock);
+        job = &task;
+        remaining = num_tasks;
+
+        /* Deal contiguous blocks, so neighboring tasks start on the same thread */
+        int num_queues = queues.size();
+        for (int q = 0; q < num_queues; q++)
+        {
+            unique_lock<mutex> queue_guard(queues[q]->lock);
+            int begin = (long) num_tasks * q / num_queues,
+                end = (long) num_tasks * (q + 1) / num_queues;
+            for (int i = begin; i < end; i++)
+                queues[q]->tasks.push_back(i);
+        }
+        generation++;
+    }
+    wake_workers.notify_all();
+
+    while (runOne(0))
+        ;
+
+    unique_lock<mutex> guard(lock);
+    while (remaining > 0)
+        batch_done.wait(guard);
+    job = NULL;
+}
+
+/*
+ *--------------------------------------------------------------------------------------
+ *       Class:  ThreadPool
+ *      Method:  bool runOne(int)
+ * Description:  Run one task, from our own queue if possible; false if none are left
+ *--------------------------------------------------------------------------------------
+ */
+bool ThreadPool::runOne(int id)
+{
+    int num_queues = queues.size(), next = -1;
+    const function<void(int)> *task = NULL;
+
+    for (int k = 0; k < num_queues && next < 0; k++)
+    {
+        TaskQueue *queue = queues[(id + k) % num_queues];
+        unique_lock<mutex> queue_guard(queue->lock);
+        if (queue->tasks.empty())
+            continue;
+
+        if (k == 0)
+        {
+            next = queue->tasks.back();
+            queue->tasks.pop_back();
+        }
+        else
+        {
+            next = queue->tasks.front();
+            queue->tasks.pop_front();
+        }
+        task = job;
+    }
+
+    if (next < 0)
+        return false;
+
+    task_depth++;
+    (*task)(next);
+    task_depth--;
+
+    unique_lock<mutex> guard(lock);
+    if (--remaining == 0)
+        batch_done.notify_all();
+    return true;
+}
+
+void ThreadPool::workerLoop(int id)
+{
+    worker_id = id;
+    int seen_generation = 0;
+
+    while (true)
+    {
+        {
+            unique_lock<mutex> guard(lock);
+            while (!stopping && generation == seen_generation)
+                wake_workers.wait(guard);
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+
+        while (runOne(id))
+            ;
+    }
+}
+
+/* #####   Accessors   ############################################################## */
+
+int ThreadPool::getNumThreads() const
+{
+    return queues.size();
+}
+
+int ThreadPool::currentWorker()
+{
+    return worker_id;
+}
+
+ThreadPool &getThreadPool(int num_threads)
+{
+    static mutex pools_lock;
+    static map<int, ThreadPool *> pools;   // Never freed: callers keep references
+
+    if (num_threads < 1)
+        num_threads = 1;
+
+    lock_guard<mutex> guard(pools_lock);
+    ThreadPool *&pool = pools[num_threads];
+    if (pool == NULL)
+        pool = new ThreadPool(num_threads);
+    return *pool;
+}